@@ -11,9 +11,11 @@ namespace argparse
     int run_with_args(
         int argc, char **argv,
         ExecuteFun exfun,
+        CompileFun compfun,
         PrintFun pfun,
         DotFun dotfun,
-        CheckReachFun crfun)
+        CheckReachFun crfun,
+        BatchFun batchfun)
     {
         CLI::App app;
         CLI::Option *version_flag = app.add_flag("--version,-v", "Print version");
@@ -21,6 +23,21 @@ namespace argparse
         std::string filepath;
         CLI::App *execute = app.add_subcommand("execute", "execute a brainfuck program");
         execute->add_option("filepath", filepath, "brainfuck file to execute")->required();
+        std::string engine_name = "threaded";
+        execute->add_option("--engine", engine_name, "interpreter backend to use (default: threaded)")
+            ->check(CLI::IsMember({"switch", "threaded", "jit"}));
+        CLI::Option *profile_flag = execute->add_flag("--profile", "run on the instrumented engine and print a hot-loop report to stderr");
+        std::string profile_out;
+        execute->add_option("--profile-out", profile_out, "also write the profile as JSON to this file")
+            ->needs(profile_flag);
+
+        std::string output = "a.out";
+        std::string compiler = "cc";
+        CLI::App *compile = app.add_subcommand("compile", "compile a brainfuck program to a native executable");
+        compile->add_option("filepath", filepath, "brainfuck file to compile")->required();
+        compile->add_option("--output,-o", output, "path of the executable (default: a.out)");
+        compile->add_option("--cc", compiler, "C compiler to build the executable with (default: cc)");
+        CLI::Option *emit_c_flag = compile->add_flag("--emit-c", "print the generated C code instead of building it");
 
         CLI::App *print = app.add_subcommand("print", "print a brainfuck program");
         print->add_option("filepath", filepath, "brainfuck file to print")->required();
@@ -29,15 +46,43 @@ namespace argparse
         CLI::App *dot = app.add_subcommand("dot", "print a dot graph of a brainfuck program's kripke structure");
         dot->add_option("filepath", filepath, "brainfuck file to analyze")->required();
 
-        std::string label;
+        std::vector<std::string> labels;
         unsigned int max_stdin_length;
         uint8_t eof_char;
         CLI::App *checkreach = app.add_subcommand("check_reach", "check if a certain label can be reached");
         checkreach->add_option("filepath", filepath, "brainfuck file to analyze")->required();
-        checkreach->add_option("label", label, "label to use for reachability analysis")->required();
+        CLI::Option *labels_opt = checkreach->add_option("labels", labels, "labels to use for reachability analysis");
+        CLI::Option *all_labels_flag = checkreach->add_flag("--all-labels", "check every label of the program");
         CLI::Option *max_stdin_len_opt = checkreach->add_option("--max-stdin-length", max_stdin_length, "maximum amount of character read on standard in");
         CLI::Option *eof_char_opt = checkreach->add_option("--eof-char", eof_char, "character to be used when EOF is signaled");
         CLI::Option *no_change_on_eof_flag = checkreach->add_flag("--no-change-on-eof", "don't change a cell's value when EOF is received");
+        CLI::Option *abstract_input_flag = checkreach->add_flag("--abstract-input", "read sets of values instead of branching on every character");
+        unsigned int reach_threads = 1;
+        checkreach->add_option("--threads", reach_threads, "number of threads for the search (default: 1)")
+            ->check(CLI::PositiveNumber);
+        std::string checker_name = "bfs";
+        checkreach->add_option("--checker", checker_name, "breadth-first search, Spot's emptiness checks or breadth-first search on disk (default: bfs)")
+            ->check(CLI::IsMember({"bfs", "spot", "external"}));
+        unsigned int max_depth;
+        CLI::Option *max_depth_opt = checkreach->add_option("--max-depth", max_depth, "only look for runs that repeat a state within this many steps")
+                                         ->check(CLI::PositiveNumber);
+        CLI::Option *deepening_flag = checkreach->add_flag("--iterative-deepening", "look for runs at growing depths during the search");
+        size_t mem_budget = 1024;
+        checkreach->add_option("--mem-budget", mem_budget, "megabytes for the states of the external checker or the visited set of --approx (default: 1024)")
+            ->check(CLI::PositiveNumber);
+        std::string approx_name;
+        CLI::Option *approx_opt = checkreach->add_option("--approx", approx_name, "keep only hashes of visited states, which may miss runs")
+                                      ->check(CLI::IsMember({"bitstate", "hashcompact"}));
+        std::string cache_directory;
+        checkreach->add_option("--cache", cache_directory, "directory to keep verdicts and state spaces in between runs");
+        CLI::Option *no_static_flag = checkreach->add_flag("--no-static-analysis", "search even for labels the program alone decides");
+
+        unsigned int threads = 0;
+        CLI::App *batch = app.add_subcommand("batch", "run the execute and check_reach jobs listed in a manifest in parallel");
+        batch->add_option("manifest", filepath, "file with one job per line")->required();
+        batch->add_option("--threads,-j", threads, "number of worker threads (default: one per core)");
+        batch->add_option("--engine", engine_name, "interpreter backend for execute jobs (default: threaded)")
+            ->check(CLI::IsMember({"switch", "threaded", "jit"}));
 
         app.require_subcommand(0, 1);
         CLI11_PARSE(app, argc, argv);
@@ -66,9 +111,26 @@ namespace argparse
                 << std::endl;
             return 0;
         }
-        else if (app.got_subcommand(execute))
+
+        bf::Engine engine = bf::Engine::ThreadedDispatch;
+        if (engine_name == "switch")
         {
-            exfun(filepath);
+            engine = bf::Engine::SwitchDispatch;
+        }
+        else if (engine_name == "jit")
+        {
+            engine = bf::Engine::Jit;
+        }
+
+        if (app.got_subcommand(execute))
+        {
+            bool profile = *profile_flag ? true : false;
+            exfun(filepath, engine, profile, profile_out);
+        }
+        else if (app.got_subcommand(compile))
+        {
+            bool emit_c = *emit_c_flag ? true : false;
+            compfun(filepath, output, compiler, emit_c);
         }
         else if (app.got_subcommand(print))
         {
@@ -81,8 +143,55 @@ namespace argparse
         }
         else if (app.got_subcommand(checkreach))
         {
-
-            crfun(filepath, label, io_model);
+            if ((*labels_opt ? 1 : 0) + (*all_labels_flag ? 1 : 0) != 1)
+            {
+                return app.exit(CLI::ValidationError("give either labels or --all-labels"));
+            }
+            if (*approx_opt && (*all_labels_flag || labels.size() > 1))
+            {
+                return app.exit(CLI::ValidationError("--approx checks a single label"));
+            }
+            bf::ReachOptions options;
+            options.abstract_input = *abstract_input_flag ? true : false;
+            options.threads = reach_threads;
+            options.checker = bf::ReachChecker::BreadthFirst;
+            if (checker_name == "spot")
+            {
+                options.checker = bf::ReachChecker::SpotEmptiness;
+            }
+            else if (checker_name == "external")
+            {
+                options.checker = bf::ReachChecker::ExternalMemory;
+            }
+            if (options.checker == bf::ReachChecker::SpotEmptiness && *max_depth_opt)
+            {
+                return app.exit(CLI::ValidationError("--max-depth needs --checker bfs or external"));
+            }
+            if (options.checker != bf::ReachChecker::BreadthFirst && *deepening_flag)
+            {
+                return app.exit(CLI::ValidationError("--iterative-deepening needs --checker bfs"));
+            }
+            if (*approx_opt && (checker_name != "bfs" || *deepening_flag))
+            {
+                return app.exit(CLI::ValidationError("--approx takes no --checker or --iterative-deepening"));
+            }
+            if (*approx_opt)
+            {
+                options.approx = approx_name == "bitstate" ? bf::ReachApprox::BitstateHashing : bf::ReachApprox::HashCompaction;
+            }
+            options.memory_budget = mem_budget << 20;
+            if (*max_depth_opt)
+            {
+                options.max_depth = max_depth;
+            }
+            options.iterative_deepening = *deepening_flag ? true : false;
+            options.cache_directory = cache_directory;
+            options.static_analysis = *no_static_flag ? false : true;
+            crfun(filepath, labels, *all_labels_flag ? true : false, io_model, options);
+        }
+        else if (app.got_subcommand(batch))
+        {
+            batchfun(filepath, threads, engine);
         }
         else
         {
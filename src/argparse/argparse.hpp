@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <optional>
 #include <brainfuck.hpp>
 
@@ -8,16 +9,20 @@ namespace bf = brainfuck;
 
 namespace argparse
 {
-    typedef void (*ExecuteFun)(std::string filename);
+    typedef void (*ExecuteFun)(std::string filename, bf::Engine engine, bool profile, std::string profile_out);
+    typedef void (*CompileFun)(std::string filename, std::string output, std::string compiler, bool emit_c);
     typedef void (*PrintFun)(std::string filename, bool without_label);
     typedef void (*DotFun)(std::string filename);
-    typedef void (*CheckReachFun)(std::string filename, std::string label, bf::IOModel io_model);
+    typedef void (*CheckReachFun)(std::string filename, std::vector<std::string> labels, bool all_labels, bf::IOModel io_model, bf::ReachOptions options);
+    typedef void (*BatchFun)(std::string manifest, unsigned int threads, bf::Engine engine);
 
     int run_with_args(
         int argc,
         char **argv,
         ExecuteFun exfun,
+        CompileFun compfun,
         PrintFun pfun,
         DotFun dotfun,
-        CheckReachFun crfun);
+        CheckReachFun crfun,
+        BatchFun batchfun);
 }
\ No newline at end of file
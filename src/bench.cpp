@@ -0,0 +1,261 @@
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <brainfuck.hpp>
+
+using namespace brainfuck;
+
+#ifndef BENCH_CORPUS
+#define BENCH_CORPUS "bench"
+#endif
+
+struct Workload
+{
+    std::string name;
+    std::string source;
+    CellSize cell_size;
+};
+
+struct Measurement
+{
+    std::string workload;
+    std::string phase;
+    std::string engine;
+    unsigned long work; // bytes parsed or instructions executed
+    std::vector<double> seconds;
+
+    double median() const
+    {
+        std::vector<double> sorted(this->seconds);
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+
+    double best() const
+    {
+        return *std::min_element(this->seconds.begin(), this->seconds.end());
+    }
+};
+
+static std::string read_file(const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Loops that run a long straight-line body, so dispatch dominates. The
+// body stays on cells 1 to 16 and leaves cell 0 as the loop counter.
+static std::string straight_line_stress()
+{
+    std::mt19937 rng(42);
+    std::string body;
+    int cell = 1;
+    for (int i = 0; i < 20000; i++)
+    {
+        int r = rng() % 4;
+        if (r == 0 && cell < 16)
+        {
+            body += '>';
+            cell++;
+        }
+        else if (r == 1 && cell > 1)
+        {
+            body += '<';
+            cell--;
+        }
+        else
+        {
+            body += rng() % 2 ? '+' : '-';
+        }
+    }
+    body += std::string(cell - 1, '<');
+    return "-[>" + body + "<-]";
+}
+
+// Scans back and forth over 20000 non-zero cells
+static std::string scan_stress()
+{
+    std::string source = "->>";
+    for (int i = 0; i < 20000; i++)
+        source += "+>";
+    return source + "<[<]<[>>[>]<[<]<-]";
+}
+
+// Megabytes of comments with a few instructions sprinkled in
+static std::string comment_stress()
+{
+    std::string comment = "This line is only here to be skipped by the parser ";
+    std::string source;
+    while (source.size() < (8 << 20))
+        source += comment + "+\n";
+    return source;
+}
+
+static std::vector<Workload> load_workloads(const std::string &corpus)
+{
+    std::vector<Workload> workloads;
+    std::vector<std::filesystem::path> files;
+    for (const auto &entry : std::filesystem::directory_iterator(corpus))
+    {
+        if (entry.path().extension() == ".bf")
+            files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto &path : files)
+    {
+        std::string source = read_file(path);
+        std::string name = path.stem().string();
+        workloads.push_back(Workload{name, source, CellSize::EightBit});
+        // The same program behaves differently with wider cells
+        if (name == "bitwidth")
+            workloads.push_back(Workload{name + "-16", source, CellSize::SixteenBit});
+        if (name == "hello")
+        {
+            std::string repeated;
+            for (int i = 0; i < 2000; i++)
+                repeated += source + "\n again\n";
+            workloads.push_back(Workload{"hello-long", repeated, CellSize::EightBit});
+        }
+    }
+    workloads.push_back(Workload{"stress-straight", straight_line_stress(), CellSize::EightBit});
+    workloads.push_back(Workload{"stress-scan", scan_stress(), CellSize::EightBit});
+    workloads.push_back(Workload{"stress-comments", comment_stress(), CellSize::EightBit});
+    return workloads;
+}
+
+template <typename F>
+static std::vector<double> sample(unsigned int samples, F &&f)
+{
+    // One untimed run to warm up caches and the allocator
+    f();
+    std::vector<double> seconds;
+    for (unsigned int i = 0; i < samples; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        seconds.push_back(std::chrono::duration<double>(end - start).count());
+    }
+    return seconds;
+}
+
+static void write_json(std::ostream &out, const std::vector<Measurement> &measurements, unsigned int samples)
+{
+    out << "{\"samples\":" << samples << ",\"results\":[";
+    for (size_t i = 0; i < measurements.size(); i++)
+    {
+        const Measurement &m = measurements[i];
+        double rate = m.work / m.median();
+        out << (i > 0 ? "," : "") << "\n{\"workload\":\"" << json_escape(m.workload)
+            << "\",\"phase\":\"" << m.phase
+            << "\",\"engine\":\"" << m.engine
+            << "\",\"" << (m.phase == "parse" ? "bytes" : "instructions") << "\":" << m.work
+            << ",\"median_s\":" << m.median()
+            << ",\"min_s\":" << m.best()
+            << ",\"" << (m.phase == "parse" ? "bytes_per_s" : "instructions_per_s") << "\":" << rate
+            << ",\"seconds\":[";
+        for (size_t s = 0; s < m.seconds.size(); s++)
+            out << (s > 0 ? "," : "") << m.seconds[s];
+        out << "]}";
+    }
+    out << "\n]}" << std::endl;
+}
+
+static void usage()
+{
+    std::cerr << "usage: benchmarks [--samples N] [--json FILE] [--corpus DIR] [--filter TEXT]" << std::endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int samples = 5;
+    std::string json_path;
+    std::string corpus = BENCH_CORPUS;
+    std::string filter;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            usage();
+        if (arg == "--samples")
+            samples = (unsigned int)atoi(argv[++i]);
+        else if (arg == "--json")
+            json_path = argv[++i];
+        else if (arg == "--corpus")
+            corpus = argv[++i];
+        else if (arg == "--filter")
+            filter = argv[++i];
+        else
+            usage();
+    }
+    if (samples == 0)
+        usage();
+
+    std::vector<std::pair<std::string, Engine>> engines{
+        std::make_pair("switch", Engine::SwitchDispatch),
+        std::make_pair("threaded", Engine::ThreadedDispatch)};
+    if (jit_available())
+        engines.push_back(std::make_pair("jit", Engine::Jit));
+
+    std::vector<Measurement> measurements;
+    printf("%-18s %-9s %-9s %14s %12s %12s\n", "workload", "phase", "engine", "work", "median ms", "per second");
+    for (const Workload &workload : load_workloads(corpus))
+    {
+        if (workload.name.find(filter) == std::string::npos)
+            continue;
+
+        MemoryModel memory_model(workload.cell_size);
+        std::vector<Measurement> results;
+        results.push_back(Measurement{workload.name, "parse", "", workload.source.size(), sample(samples, [&]()
+                                                                                                 {
+            std::istringstream source(workload.source);
+            Program::parse_from_istream(&source, memory_model, IOModel()); })});
+
+        std::istringstream source(workload.source);
+        Program prog = Program::parse_from_istream(&source, memory_model, IOModel());
+        // Instructions in the source sense, counted once on the profiler
+        MemorySource no_input("");
+        MemorySink ignored;
+        unsigned long instructions = run_profiled(prog, no_input, ignored).steps;
+
+        for (const auto &engine : engines)
+        {
+            results.push_back(Measurement{workload.name, "run", engine.first, instructions, sample(samples, [&]()
+                                                                                                   {
+                MemorySource input("");
+                MemorySink output;
+                prog.run(input, output, engine.second); })});
+        }
+
+        for (const Measurement &m : results)
+        {
+            printf("%-18s %-9s %-9s %14lu %12.3f %12.3g\n",
+                   m.workload.c_str(), m.phase.c_str(), m.engine.c_str(),
+                   m.work, m.median() * 1000, m.work / m.median());
+            measurements.push_back(m);
+        }
+    }
+
+    if (!json_path.empty())
+    {
+        std::ofstream json(json_path);
+        if (!json.is_open())
+        {
+            std::cerr << "Could not write " << json_path << std::endl;
+            return 1;
+        }
+        write_json(json, measurements, samples);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+Prints the number of bits per cell as a character offset from '0'
+ie "8" for 8 bit cells; "@" for 16 bit cells and "P" for 32 bit cells
+
+Cell 0 holds a power of two; cell 1 counts the doublings
++[
+    >+<           count
+    [->>++<<]     double into cell 2
+    >>[-<<+>>]<<  and move it back
+]
+>++++++++++++++++++++++++++++++++++++++++++++++++.
@@ -0,0 +1,6 @@
+Three nested counting loops with 255^3 innermost iterations; the innermost
+loop is a plain transfer loop so the optimizer sees it as a multiplication
+while the outer ones stay real loops; prints "!" at the end
+
+-[>-[>-[>+>+<<-]<-]<-]
+>>>>>+++++++++++++++++++++++++++++++++.
@@ -1,21 +1,47 @@
+#include <map>
+#include <memory>
 #include <string>
+#include <algorithm>
 #include <optional>
 #include <spot/tl/parse.hh>
 #include <spot/twaalgos/translate.hh>
 #include <spot/twaalgos/emptiness.hh>
+#include <spot/twacube_algos/convert.hh>
+#include <spot/mc/mc_instanciator.hh>
 #include "analysis.hpp"
 #include "program.hpp"
 #include "kripke.hpp"
+#include "cube.hpp"
+#include "bfs.hpp"
+#include "external.hpp"
+#include "approx.hpp"
+#include "cache.hpp"
+#include "flow.hpp"
 
 namespace brainfuck
 {
-    std::optional<spot::twa_run_ptr> check_reach(Program prog, std::string label)
+    // The automaton for "the label is never reached", translated once per
+    // label for as long as the program runs. Like the rest of Spot, not to
+    // be used from many threads at once.
+    static spot::twa_graph_ptr never_reached(const std::string &label)
     {
-        auto d = spot::make_bdd_dict();
+        static spot::bdd_dict_ptr dict = spot::make_bdd_dict();
+        static std::map<std::string, spot::twa_graph_ptr> automata;
+        auto it = automata.find(label);
+        if (it != automata.end())
+            return it->second;
+
         auto f = spot::formula::F(spot::formula::ap(label));
         auto nf = spot::formula::Not(f);
-        spot::twa_graph_ptr af = spot::translator(d).run(nf);
-        auto k = std::make_shared<Kripke>(prog, d);
+        spot::twa_graph_ptr af = spot::translator(dict).run(nf);
+        automata.emplace(label, af);
+        return af;
+    }
+
+    static std::optional<spot::twa_run_ptr> spot_search(const Program &prog, const std::string &label, bool abstract_input)
+    {
+        spot::twa_graph_ptr af = never_reached(label);
+        auto k = std::make_shared<Kripke>(prog, af->get_dict(), abstract_input);
         if (auto run = k->intersecting_run(af))
         {
             return std::optional<spot::twa_run_ptr>{run};
@@ -25,4 +51,482 @@ namespace brainfuck
             return std::nullopt;
         }
     }
+
+    // Whether some run avoids the label, decided by CNDFS on all threads.
+    // Spot is only used before the threads start, which then work on cubes.
+    static bool parallel_search(const Program &prog, const std::string &label, bool abstract_input, unsigned int threads)
+    {
+        spot::twacube_ptr prop = spot::twa_to_twacube(never_reached(label));
+        auto sys = std::make_shared<KripkeCube>(prog, prop->ap(), abstract_input, threads);
+        auto stats = spot::ec_instanciator<kripkecube_ptr, shared_state_id_t, KCubeIterator,
+                                           KCubeStateHash, KCubeStateEqual>(
+            spot::mc_algorithm::CNDFS, sys, prop, false);
+        return std::find(stats.value.begin(), stats.value.end(), spot::mc_rvalue::NOT_EMPTY) != stats.value.end();
+    }
+
+    // A run of the breadth-first search as a run of a Kripke structure, so
+    // that it prints and expands like the ones Spot finds
+    static spot::twa_run_ptr make_twa_run(const Program &prog, const ReachRun &reach_run, bool abstract_input)
+    {
+        auto k = std::make_shared<Kripke>(prog, spot::make_bdd_dict(), abstract_input);
+        auto run = std::make_shared<spot::twa_run>(k);
+        for (const auto &kv : {std::make_pair(&reach_run.prefix, &run->prefix),
+                               std::make_pair(&reach_run.cycle, &run->cycle)})
+        {
+            for (const PackedState &state : *kv.first)
+            {
+                const KState *s = k->make_state(state);
+                kv.second->push_back(spot::twa_run::step{s, k->state_condition(s), {}});
+            }
+        }
+        return run;
+    }
+
+    // The states of a run on a Kripke structure, to keep it in a cache
+    static std::optional<ReachRun> reach_run_of(const spot::twa_run_ptr &run)
+    {
+        auto k = std::dynamic_pointer_cast<const Kripke>(run->aut);
+        if (k == nullptr)
+            return std::nullopt;
+        ReachRun reach_run;
+        for (const auto &kv : {std::make_pair(&run->prefix, &reach_run.prefix),
+                               std::make_pair(&run->cycle, &reach_run.cycle)})
+        {
+            for (const auto &step : *kv.first)
+                kv.second->push_back(k->get_store().pack(static_cast<const KState *>(step.s)->get_id()));
+        }
+        return reach_run;
+    }
+
+    // Approximate searches may miss runs, so they are never cached
+    static std::unique_ptr<ResultCache> open_cache(const ReachOptions &options)
+    {
+        if (options.cache_directory.empty() || options.approx != ReachApprox::ExactStates)
+            return nullptr;
+        return std::make_unique<ResultCache>(options.cache_directory);
+    }
+
+    static void keep_verdict(const ResultCache &cache, const Program &prog, const std::string &label,
+                             const ReachOptions &options, const std::optional<spot::twa_run_ptr> &m_run,
+                             bool abstract_input, bool bounded)
+    {
+        CachedVerdict verdict{std::nullopt, abstract_input, bounded};
+        if (m_run.has_value())
+        {
+            verdict.run = reach_run_of(m_run.value());
+            if (!verdict.run.has_value())
+                return;
+        }
+        cache.store_verdict(prog, label, options, verdict);
+    }
+
+    // The space of bfs_explore from the cache, explored and kept there if
+    // it isn't yet
+    static StateSpace cached_space(const ResultCache &cache, const Program &prog, bool abstract_input,
+                                   const ReachOptions &options)
+    {
+        auto m_space = cache.find_space(prog, abstract_input, options);
+        if (m_space.has_value())
+            return std::move(m_space.value());
+        StateSpace space = bfs_explore(prog, abstract_input, options);
+        cache.store_space(prog, options, space);
+        return space;
+    }
+
+    static std::optional<spot::twa_run_ptr> search(const Program &prog, const std::string &label,
+                                                   const ReachOptions &options, bool abstract_input,
+                                                   const ResultCache *cache, bool *bounded, ApproxReport *report)
+    {
+        if (options.checker == ReachChecker::SpotEmptiness && options.approx == ReachApprox::ExactStates)
+        {
+            // When the label is always reached the parallel check is all
+            // there is to do. Otherwise the sequential search finds the run
+            // again, so it is the same run either way.
+            if (options.threads > 1 && !parallel_search(prog, label, abstract_input, options.threads))
+                return std::nullopt;
+            return spot_search(prog, label, abstract_input);
+        }
+
+        std::optional<ReachRun> m_run;
+        std::optional<StateSpace> m_space;
+        if (options.approx == ReachApprox::ExactStates && options.checker == ReachChecker::BreadthFirst &&
+            cache != nullptr)
+            m_space = cache->find_space(prog, abstract_input, options);
+
+        if (options.approx != ReachApprox::ExactStates)
+            m_run = approx_reach(prog, label, abstract_input, options, bounded, report);
+        else if (m_space.has_value())
+            m_run = space_reach(prog, m_space.value(), label, bounded);
+        else if (options.checker == ReachChecker::BreadthFirst)
+            m_run = bfs_reach(prog, label, abstract_input, options, bounded);
+        else
+            m_run = external_reach(prog, label, abstract_input, options, bounded);
+        if (!m_run.has_value())
+            return std::nullopt;
+        return make_twa_run(prog, m_run.value(), abstract_input);
+    }
+
+    // check_reach without the verdict cache. abstract_run is set to whether
+    // the run is on the abstract Kripke structure.
+    static std::optional<spot::twa_run_ptr> decide(const Program &prog, const std::string &label,
+                                                   const ReachOptions &options, const ResultCache *cache,
+                                                   bool *bounded, ApproxReport *report, bool *abstract_run)
+    {
+        *abstract_run = options.abstract_input;
+        auto m_run = search(prog, label, options, options.abstract_input, cache, bounded, report);
+        if (!options.abstract_input || !m_run.has_value())
+            return m_run;
+
+        // Splitting value sets at every zero test keeps each cell exact, so
+        // an abstract run should always have an input that drives it. If it
+        // doesn't, the run is spurious and the concrete model decides.
+        if (concretize_input(prog, expand_run(m_run.value())).has_value())
+            return m_run;
+        *abstract_run = false;
+        return search(prog, label, options, false, cache, bounded, report);
+    }
+
+    // Whether the static analysis decides the label, with m_run set to the
+    // verdict if it does. Runs longer than max_depth are left to the search.
+    static bool decide_statically(const Program &prog, const FlowAnalysis &flow, const std::string &label,
+                                  const ReachOptions &options, std::optional<spot::twa_run_ptr> *m_run)
+    {
+        ReachRun run;
+        switch (flow.decide(prog, label, &run))
+        {
+        case StaticAlwaysReached:
+            *m_run = std::nullopt;
+            return true;
+
+        case StaticRunFound:
+            if (options.max_depth.has_value() && run.prefix.size() + run.cycle.size() > options.max_depth.value())
+                return false;
+            *m_run = make_twa_run(prog, run, false);
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    // Approximate searches always search, so that the report is of one
+    static bool use_static_analysis(const ReachOptions &options)
+    {
+        return options.static_analysis && options.approx == ReachApprox::ExactStates;
+    }
+
+    std::optional<spot::twa_run_ptr> check_reach(const Program &prog, std::string label, const ReachOptions &options,
+                                                 bool *bounded, ApproxReport *report)
+    {
+        if (bounded != nullptr)
+            *bounded = false;
+        std::optional<spot::twa_run_ptr> m_static;
+        if (use_static_analysis(options) && decide_statically(prog, FlowAnalysis(prog), label, options, &m_static))
+            return m_static;
+        std::unique_ptr<ResultCache> cache = open_cache(options);
+        if (cache != nullptr)
+        {
+            auto m_verdict = cache->find_verdict(prog, label, options);
+            if (m_verdict.has_value())
+            {
+                if (bounded != nullptr)
+                    *bounded = m_verdict.value().bounded;
+                if (!m_verdict.value().run.has_value())
+                    return std::nullopt;
+                return make_twa_run(prog, m_verdict.value().run.value(), m_verdict.value().abstract_input);
+            }
+        }
+
+        bool run_bounded = false;
+        bool abstract_run = false;
+        auto m_run = decide(prog, label, options, cache.get(), &run_bounded, report, &abstract_run);
+        if (bounded != nullptr)
+            *bounded = run_bounded;
+        if (cache != nullptr)
+            keep_verdict(*cache, prog, label, options, m_run, abstract_run, run_bounded);
+        return m_run;
+    }
+
+    // Verdicts for every label under one abstraction. Only the plain
+    // breadth-first search shares one exploration between the labels.
+    static std::vector<LabelVerdict> search_all(const Program &prog, const std::vector<std::string> &labels,
+                                                const ReachOptions &options, bool abstract_input,
+                                                const ResultCache *cache)
+    {
+        std::vector<LabelVerdict> verdicts;
+        if (options.checker != ReachChecker::BreadthFirst || options.approx != ReachApprox::ExactStates ||
+            options.iterative_deepening)
+        {
+            for (const std::string &label : labels)
+            {
+                LabelVerdict verdict{label, std::nullopt, false};
+                verdict.run = search(prog, label, options, abstract_input, cache, &verdict.bounded, nullptr);
+                verdicts.push_back(verdict);
+            }
+            return verdicts;
+        }
+
+        // Nothing is cut while exploring, so the space serves every label
+        StateSpace space = cache != nullptr ? cached_space(*cache, prog, abstract_input, options)
+                                            : bfs_explore(prog, abstract_input, options);
+        for (const std::string &label : labels)
+        {
+            LabelVerdict verdict{label, std::nullopt, false};
+            auto m_run = space_reach(prog, space, label, &verdict.bounded);
+            if (m_run.has_value())
+                verdict.run = make_twa_run(prog, m_run.value(), abstract_input);
+            verdicts.push_back(verdict);
+        }
+        return verdicts;
+    }
+
+    std::vector<LabelVerdict> check_reach_all(const Program &prog, const std::vector<std::string> &labels,
+                                              const ReachOptions &options)
+    {
+        std::unique_ptr<ResultCache> cache = open_cache(options);
+        std::optional<FlowAnalysis> m_flow;
+        if (use_static_analysis(options))
+            m_flow.emplace(prog);
+        std::vector<LabelVerdict> verdicts;
+        std::vector<std::string> missing;
+        std::vector<size_t> indices;
+        for (const std::string &label : labels)
+        {
+            LabelVerdict verdict{label, std::nullopt, false};
+            if (m_flow.has_value() && decide_statically(prog, m_flow.value(), label, options, &verdict.run))
+            {
+                verdicts.push_back(verdict);
+                continue;
+            }
+            auto m_verdict = cache != nullptr ? cache->find_verdict(prog, label, options) : std::nullopt;
+            if (m_verdict.has_value())
+            {
+                verdict.bounded = m_verdict.value().bounded;
+                if (m_verdict.value().run.has_value())
+                    verdict.run = make_twa_run(prog, m_verdict.value().run.value(), m_verdict.value().abstract_input);
+            }
+            else
+            {
+                missing.push_back(label);
+                indices.push_back(verdicts.size());
+            }
+            verdicts.push_back(verdict);
+        }
+        if (missing.empty())
+            return verdicts;
+
+        std::vector<LabelVerdict> found = search_all(prog, missing, options, options.abstract_input, cache.get());
+        std::vector<bool> abstract_runs(found.size(), options.abstract_input);
+        if (options.abstract_input)
+        {
+            // Labels with spurious abstract runs are decided again together
+            std::vector<std::string> spurious;
+            std::vector<size_t> spurious_indices;
+            for (size_t i = 0; i < found.size(); i++)
+            {
+                const auto &run = found[i].run;
+                if (run.has_value() && !concretize_input(prog, expand_run(run.value())).has_value())
+                {
+                    spurious.push_back(found[i].label);
+                    spurious_indices.push_back(i);
+                }
+            }
+            if (!spurious.empty())
+            {
+                std::vector<LabelVerdict> concrete = search_all(prog, spurious, options, false, cache.get());
+                for (size_t i = 0; i < spurious_indices.size(); i++)
+                {
+                    found[spurious_indices[i]] = concrete[i];
+                    abstract_runs[spurious_indices[i]] = false;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < found.size(); i++)
+        {
+            verdicts[indices[i]] = found[i];
+            if (cache != nullptr)
+                keep_verdict(*cache, prog, found[i].label, options, found[i].run, abstract_runs[i], found[i].bounded);
+        }
+        return verdicts;
+    }
+
+    RunTrace expand_run(const spot::twa_run_ptr &run)
+    {
+        RunTrace trace;
+        auto k = std::dynamic_pointer_cast<const Kripke>(run->aut);
+        std::vector<const KState *> states;
+        for (const auto *steps : {&run->prefix, &run->cycle})
+        {
+            for (const auto &step : *steps)
+                states.push_back(static_cast<const KState *>(step.s));
+        }
+
+        // The last state of the cycle leads back to its first one
+        size_t prefix_size = run->prefix.size();
+        for (size_t i = 0; i < states.size(); i++)
+        {
+            std::vector<instr_ptr_t> &pcs = i < prefix_size ? trace.prefix : trace.cycle;
+            const KState *next = nullptr;
+            if (i + 1 < states.size())
+                next = states[i + 1];
+            else if (!run->cycle.empty())
+                next = states[prefix_size];
+
+            if (k != nullptr && next != nullptr)
+            {
+                auto expanded = k->expand_transition(states[i], next);
+                pcs.insert(pcs.end(), expanded.begin(), expanded.end());
+            }
+            else
+            {
+                pcs.push_back(states[i]->get_instr_ptr());
+            }
+        }
+        return trace;
+    }
+
+    // A cell during concretization, either a byte or the value of a read
+    // plus an offset
+    struct SymbolicCell
+    {
+        bool symbolic;
+        uint8_t value;
+        size_t read;
+    };
+
+    // What the branches along a trace require of one read
+    struct ReadConstraint
+    {
+        std::optional<uint8_t> fixed;
+        std::vector<bool> excluded;
+    };
+
+    std::optional<std::vector<uint8_t>> concretize_input(const Program &prog, const RunTrace &trace)
+    {
+        const std::vector<Instruction> &instrs = prog.get_instructions();
+        std::vector<instr_ptr_t> jumps(instrs.size(), 0);
+        for (const auto &kv : prog.get_jmp_map())
+            jumps[kv.first] = kv.second;
+        std::vector<instr_ptr_t> pcs(trace.prefix);
+        pcs.insert(pcs.end(), trace.cycle.begin(), trace.cycle.end());
+
+        std::optional<size_t> remaining = prog.io_model.get_chars_until_eof();
+        std::map<mem_ptr_t, SymbolicCell> cells;
+        std::vector<ReadConstraint> reads;
+        mem_ptr_t ptr = 0;
+        for (size_t i = 0; i < pcs.size(); i++)
+        {
+            instr_ptr_t pc = pcs[i];
+            if (pc >= instrs.size())
+                break;
+            SymbolicCell &cell = cells.emplace(ptr, SymbolicCell{false, 0, 0}).first->second;
+            switch (instrs[pc])
+            {
+            case Instruction::left:
+                ptr = ptr == 0 ? KRIPKE_MEMORY_SIZE - 1 : ptr - 1;
+                break;
+
+            case Instruction::right:
+                ptr = ptr == KRIPKE_MEMORY_SIZE - 1 ? 0 : ptr + 1;
+                break;
+
+            case Instruction::inc:
+                cell.value++;
+                break;
+
+            case Instruction::dec:
+                cell.value--;
+                break;
+
+            case Instruction::put:
+                break;
+
+            case Instruction::get:
+                if (remaining.has_value() && remaining.value() == 0)
+                {
+                    if (!prog.io_model.get_no_change_on_eof())
+                        cell = SymbolicCell{false, prog.io_model.get_eof_char(), 0};
+                    break;
+                }
+                if (remaining.has_value())
+                    remaining = remaining.value() - 1;
+                cell = SymbolicCell{true, 0, reads.size()};
+                reads.push_back(ReadConstraint{std::nullopt, std::vector<bool>(256, false)});
+                break;
+
+            case Instruction::fwd:
+            case Instruction::bwd:
+            {
+                // The next pc tells which way the test went; the end of the
+                // cycle continues at its start
+                std::optional<instr_ptr_t> next;
+                if (i + 1 < pcs.size())
+                    next = pcs[i + 1];
+                else if (!trace.cycle.empty())
+                    next = trace.cycle.front();
+                if (!next.has_value())
+                    break;
+                bool zero = instrs[pc] == Instruction::fwd ? next.value() == jumps[pc] : next.value() != jumps[pc];
+                if (!cell.symbolic)
+                {
+                    if (zero != (cell.value == 0))
+                        return std::nullopt;
+                    break;
+                }
+                // The read plus the offset is zero exactly for one byte
+                ReadConstraint &read = reads[cell.read];
+                uint8_t root = (uint8_t)(256 - cell.value);
+                if (zero)
+                {
+                    if ((read.fixed.has_value() && read.fixed.value() != root) || read.excluded[root])
+                        return std::nullopt;
+                    read.fixed = root;
+                    cell = SymbolicCell{false, 0, 0};
+                }
+                else
+                {
+                    if (read.fixed.has_value() && read.fixed.value() == root)
+                        return std::nullopt;
+                    read.excluded[root] = true;
+                }
+                break;
+            }
+
+            default:
+                abort();
+            }
+        }
+
+        std::vector<uint8_t> input;
+        for (const ReadConstraint &read : reads)
+        {
+            if (read.fixed.has_value())
+            {
+                input.push_back(read.fixed.value());
+                continue;
+            }
+            auto free = std::find(read.excluded.begin(), read.excluded.end(), false);
+            if (free == read.excluded.end())
+                return std::nullopt;
+            input.push_back((uint8_t)(free - read.excluded.begin()));
+        }
+        return input;
+    }
+
+    std::string run_trace(const Program &prog, const spot::twa_run_ptr &run)
+    {
+        const std::vector<Instruction> &instrs = prog.get_instructions();
+        RunTrace expanded = expand_run(run);
+        std::string trace;
+        for (const auto *pcs : {&expanded.prefix, &expanded.cycle})
+        {
+            for (instr_ptr_t pc : *pcs)
+            {
+                if (pc < instrs.size())
+                    trace.push_back(instr_char(instrs[pc]));
+            }
+        }
+        return trace;
+    }
 }
\ No newline at end of file
@@ -1,11 +1,117 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <optional>
 #include <spot/twa/twa.hh>
 #include "program.hpp"
 
 namespace brainfuck
 {
-    std::optional<spot::twa_run_ptr> check_reach(Program prog, std::string label);
+    // Backends for check_reach
+    enum ReachChecker
+    {
+        BreadthFirst, // search made for reachability, finds the shortest runs
+        SpotEmptiness, // Spot's emptiness checks on the product with the formula
+        ExternalMemory // breadth-first search that keeps the states on disk
+    };
+
+    // Visited sets that give up exactness to fit in memory. States that
+    // are taken as seen by mistake are never explored, so a run that is
+    // found is real, but there may be runs the search never got to.
+    enum ReachApprox
+    {
+        ExactStates,     // every state kept as it is
+        BitstateHashing, // a few bits of one bit array per state, like SPIN's supertrace
+        HashCompaction   // a table of 64 bit fingerprints
+    };
+
+    struct ReachOptions
+    {
+        // Let a , read a set of values instead of branching 256 ways
+        bool abstract_input = false;
+        ReachChecker checker = ReachChecker::BreadthFirst;
+        // Threads of the breadth-first search. With Spot, more than one
+        // runs its multi-core emptiness check for the verdict, and the run
+        // itself still comes from the sequential one.
+        unsigned int threads = 1;
+        // Only look for runs that repeat a state within this many steps of
+        // the Kripke structure. Spot's checks ignore it, and approximate
+        // searches keep their stack within it, as SPIN's -m does.
+        std::optional<unsigned int> max_depth;
+        // Look for runs within growing depths while the search goes on, so
+        // that short runs turn up even when the state space never ends.
+        // Breadth-first search only.
+        bool iterative_deepening = false;
+        // Bytes of states the external search holds in memory at once, or
+        // of the visited set of an approximate search
+        size_t memory_budget = (size_t)1 << 30;
+        // Approximate searches go depth-first on one thread, and take no
+        // checker or iterative deepening
+        ReachApprox approx = ReachApprox::ExactStates;
+        // Directory of a ResultCache to take verdicts from and keep them in,
+        // none if empty. The breadth-first search also reuses the state
+        // spaces check_reach_all keeps there. Approximate searches skip it.
+        std::string cache_directory;
+        // Decide labels a FlowAnalysis of the program settles before any
+        // search. Approximate searches always search.
+        bool static_analysis = true;
+    };
+
+    // How far an approximate search got and how much it may have missed
+    struct ApproxReport
+    {
+        size_t states = 0;          // states taken as new
+        size_t memory_bytes = 0;    // of the visited set
+        unsigned int hashes = 0;    // bits per state for bitstate hashing
+        bool table_full = false;    // hash compaction dropped states for lack of room
+        size_t depth = 0;           // deepest the search stack got
+        bool depth_limited = false; // states past max_depth were left out
+        // The rest only counts states lost to hash collisions, not to a full table
+        double expected_omissions = 0;
+        double omission_probability = 0; // of missing at least one state
+        double coverage = 1;             // share of the states that were explored
+    };
+
+    // A run on which the label is never reached, if there is one. Runs that
+    // end count as well, as if the program stayed where it ended. If bounded
+    // is given, it is set when there is no run only within max_depth. The
+    // report is filled in by approximate searches. Throws CacheException if
+    // the cache directory can't be written.
+    std::optional<spot::twa_run_ptr> check_reach(const Program &prog, std::string label,
+                                                 const ReachOptions &options = ReachOptions(),
+                                                 bool *bounded = nullptr, ApproxReport *report = nullptr);
+
+    // What check_reach_all found for one label
+    struct LabelVerdict
+    {
+        std::string label;
+        std::optional<spot::twa_run_ptr> run;
+        bool bounded; // no run only within max_depth
+    };
+
+    // check_reach for many labels, in their order. The breadth-first search
+    // explores the state space once for all of them, other checkers and
+    // approximate searches go label by label.
+    std::vector<LabelVerdict> check_reach_all(const Program &prog, const std::vector<std::string> &labels,
+                                              const ReachOptions &options = ReachOptions());
+
+    // The pcs of every instruction executed along a run
+    struct RunTrace
+    {
+        std::vector<instr_ptr_t> prefix;
+        std::vector<instr_ptr_t> cycle;
+    };
+
+    // Expands the transitions of a run on a Kripke structure, which can
+    // each stand for many instructions, back into single instructions
+    RunTrace expand_run(const spot::twa_run_ptr &run);
+
+    // Bytes for the reads along a trace, in order, such that the program
+    // takes every branch the trace takes, or nothing if no input does. The
+    // cycle is followed once.
+    std::optional<std::vector<uint8_t>> concretize_input(const Program &prog, const RunTrace &trace);
+
+    // The instructions executed along a run, prefix followed by cycle
+    std::string run_trace(const Program &prog, const spot::twa_run_ptr &run);
 }
\ No newline at end of file
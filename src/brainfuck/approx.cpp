@@ -0,0 +1,243 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include "approx.hpp"
+#include "kripke.hpp"
+
+namespace brainfuck
+{
+    // Bits set per state for bitstate hashing, as in SPIN
+    static const unsigned int BITSTATE_HASHES = 3;
+    // Hash compaction stops taking states past this share of its slots
+    static const double MAX_LOAD = 0.9;
+    static const size_t INTEGRATION_STEPS = 1024;
+    // The store states are expanded in starts over past this
+    static const size_t APPROX_STORE_BYTES = 64 << 20;
+    static const size_t NO_FRAME = std::numeric_limits<size_t>::max();
+
+    static const PackedStateHash FIRST_HASH{0x243f6a8885a308d3ULL};
+    static const PackedStateHash SECOND_HASH{0x13198a2e03707344ULL};
+
+    static size_t floor_power_of_two(size_t n)
+    {
+        size_t power = 1;
+        while (power <= n / 2)
+            power *= 2;
+        return power;
+    }
+
+    ApproxVisitedSet::ApproxVisitedSet(ReachApprox approx, size_t bytes)
+    {
+        this->approx = approx;
+        this->count = 0;
+        this->full = false;
+        size_t words = floor_power_of_two(std::max<size_t>(bytes / sizeof(uint64_t), 1));
+        this->mask = approx == ReachApprox::BitstateHashing ? words * 64 - 1 : words - 1;
+        this->words = std::make_unique<uint64_t[]>(words);
+        std::fill(this->words.get(), this->words.get() + words, 0);
+    }
+
+    bool ApproxVisitedSet::insert(const PackedState &state)
+    {
+        uint64_t first = FIRST_HASH(state);
+        uint64_t second = SECOND_HASH(state);
+        if (this->approx == ReachApprox::BitstateHashing)
+        {
+            // The positions of every hash from two, after Kirsch and
+            // Mitzenmacher. The step is odd so that they never repeat.
+            bool seen = true;
+            for (unsigned int i = 0; i < BITSTATE_HASHES; i++)
+            {
+                size_t bit = (first + i * (second | 1)) & this->mask;
+                uint64_t flag = 1ULL << (bit % 64);
+                seen = seen && (this->words[bit / 64] & flag) != 0;
+                this->words[bit / 64] |= flag;
+            }
+            if (!seen)
+                this->count++;
+            return !seen;
+        }
+
+        // 0 marks an empty slot
+        uint64_t fingerprint = first != 0 ? first : 1;
+        size_t slot = second & this->mask;
+        while (this->words[slot] != 0)
+        {
+            if (this->words[slot] == fingerprint)
+                return false;
+            slot = (slot + 1) & this->mask;
+        }
+        if (this->count + 1 > MAX_LOAD * (this->mask + 1))
+        {
+            this->full = true;
+            return false;
+        }
+        this->words[slot] = fingerprint;
+        this->count++;
+        return true;
+    }
+
+    void ApproxVisitedSet::fill_report(ApproxReport &report) const
+    {
+        double n = this->count;
+        report.states = this->count;
+        report.table_full = this->full;
+        if (this->approx == ReachApprox::BitstateHashing)
+        {
+            // A new state is lost when all its bits are set already, which
+            // after x states happens with (1 - e^(-kx/m))^k
+            double m = this->mask + 1.0;
+            double k = BITSTATE_HASHES;
+            auto lost = [&](double x)
+            { return std::pow(1 - std::exp(-k * x / m), k); };
+            double sum = 0;
+            for (size_t i = 0; i < INTEGRATION_STEPS; i++)
+            {
+                double x = n * i / INTEGRATION_STEPS;
+                sum += (lost(x) + lost(x + n / INTEGRATION_STEPS)) / 2;
+            }
+            report.memory_bytes = (this->mask + 1) / 8;
+            report.hashes = BITSTATE_HASHES;
+            report.expected_omissions = sum * n / INTEGRATION_STEPS;
+        }
+        else
+        {
+            // Every pair of states shares a fingerprint with 2^-64
+            report.memory_bytes = (this->mask + 1) * sizeof(uint64_t);
+            report.hashes = 0;
+            report.expected_omissions = n * (n - 1) / 2 / std::pow(2.0, 64);
+        }
+        report.omission_probability = 1 - std::exp(-report.expected_omissions);
+        report.coverage = n > 0 ? n / (n + report.expected_omissions) : 1;
+    }
+
+    // A state on the search stack and the successor to go to next
+    struct ApproxFrame
+    {
+        state_id_t state;
+        size_t next;
+    };
+
+    std::optional<ReachRun> approx_reach(const Program &prog, const std::string &label, bool abstract_input,
+                                         const ReachOptions &options, bool *bounded, ApproxReport *report)
+    {
+        KProgram kprog(prog, abstract_input);
+        std::vector<bool> targets(kprog.ops.size() + 1, false);
+        for (const auto &kv : prog.get_label_map())
+        {
+            if (kv.second == label)
+                targets[kv.first] = true;
+        }
+        auto is_target = [&](const StateHeader &header)
+        {
+            return targets[std::min<size_t>(header.pc, kprog.ops.size())];
+        };
+        size_t max_depth = options.max_depth.has_value() ? options.max_depth.value() : std::numeric_limits<size_t>::max();
+        if (bounded != nullptr)
+            *bounded = false;
+
+        // The stack holds ids in the store, and only the successors of the
+        // frame on top are there at a time. A frame gets them again when
+        // the search comes back to it.
+        ApproxVisitedSet visited(options.approx, options.memory_budget);
+        auto store = std::make_unique<StateStore>(KRIPKE_MEMORY_SIZE);
+        size_t store_bytes = APPROX_STORE_BYTES;
+        std::vector<ApproxFrame> stack;
+        std::unordered_map<state_id_t, size_t> on_stack;
+        std::vector<state_id_t> found;
+        size_t expanded = NO_FRAME; // frame the successors in found are of
+        size_t deepest = 0;
+        bool cut_off = false;
+        auto push = [&](state_id_t state)
+        {
+            on_stack.emplace(state, stack.size());
+            stack.push_back(ApproxFrame{state, 0});
+            deepest = std::max(deepest, stack.size());
+        };
+
+        // Starting over in a new store keeps only the states on the stack.
+        // It takes twice what they need before the next time, so the stack
+        // alone doesn't make it start over at every step.
+        auto renew_store = [&]()
+        {
+            auto fresh = std::make_unique<StateStore>(KRIPKE_MEMORY_SIZE);
+            on_stack.clear();
+            for (size_t i = 0; i < stack.size(); i++)
+            {
+                stack[i].state = fresh->unpack(store->pack(stack[i].state));
+                on_stack.emplace(stack[i].state, i);
+            }
+            store = std::move(fresh);
+            store_bytes = std::max(APPROX_STORE_BYTES, 2 * store->memory_usage());
+        };
+
+        PackedState initial;
+        initial.header = StateHeader{0, 0, std::nullopt};
+        if (kprog.chars_until_eof.has_value())
+            initial.header.remaining_stdin_chars = (unsigned int)kprog.chars_until_eof.value();
+        if (!is_target(initial.header) && max_depth == 0)
+        {
+            cut_off = true;
+        }
+        else if (!is_target(initial.header))
+        {
+            visited.insert(initial);
+            push(store->unpack(initial));
+        }
+
+        std::optional<ReachRun> m_run;
+        while (!stack.empty() && !m_run.has_value())
+        {
+            if (expanded != stack.size() - 1)
+            {
+                if (store->memory_usage() > store_bytes)
+                    renew_store();
+                found.clear();
+                successors(kprog, *store, stack.back().state, found, nullptr);
+                expanded = stack.size() - 1;
+            }
+            ApproxFrame &frame = stack.back();
+            if (frame.next == found.size())
+            {
+                on_stack.erase(frame.state);
+                stack.pop_back();
+                expanded = NO_FRAME;
+                continue;
+            }
+            state_id_t successor = found[frame.next++];
+            if (is_target(store->get_header(successor)))
+                continue;
+
+            // Back to a state on the stack: the stack from there on repeats
+            auto it = on_stack.find(successor);
+            if (it != on_stack.end())
+            {
+                ReachRun run;
+                for (size_t i = 0; i < stack.size(); i++)
+                    (i < it->second ? run.prefix : run.cycle).push_back(store->pack(stack[i].state));
+                m_run = run;
+            }
+            else if (stack.size() >= max_depth)
+            {
+                // Too deep, like SPIN's -m. It stays unseen so that a
+                // shorter way to it can still go on from there.
+                cut_off = true;
+            }
+            else if (visited.insert(store->pack(successor)))
+            {
+                push(successor);
+            }
+        }
+
+        if (bounded != nullptr && !m_run.has_value())
+            *bounded = cut_off;
+        if (report != nullptr)
+        {
+            visited.fill_report(*report);
+            report->depth = deepest;
+            report->depth_limited = cut_off;
+        }
+        return m_run;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <stdint.h>
+#include "program.hpp"
+#include "store.hpp"
+#include "analysis.hpp"
+#include "bfs.hpp"
+
+namespace brainfuck
+{
+    // Set of states that keeps only hashes of them, so it may take a new
+    // state as seen but never the other way around
+    class ApproxVisitedSet
+    {
+    private:
+        ReachApprox approx;
+        size_t mask; // slots or bits minus one, a power of two less one
+        std::unique_ptr<uint64_t[]> words;
+        size_t count;
+        bool full;
+
+    public:
+        // The largest set of the given kind that fits in the bytes
+        ApproxVisitedSet(ReachApprox approx, size_t bytes);
+        // True if the state was taken as new
+        bool insert(const PackedState &state);
+        void fill_report(ApproxReport &report) const;
+    };
+
+    // Looks for a run that never reaches the label depth-first, with only
+    // the states on the search stack kept whole, in a StateStore. A
+    // successor that is on the stack closes a cycle, so any run found is
+    // real, but states taken as seen by mistake are never explored. With
+    // options.max_depth the stack never gets deeper than that, and bounded
+    // is set if no run was found while states past it were left out.
+    std::optional<ReachRun> approx_reach(const Program &prog, const std::string &label, bool abstract_input,
+                                         const ReachOptions &options, bool *bounded = nullptr,
+                                         ApproxReport *report = nullptr);
+}
\ No newline at end of file
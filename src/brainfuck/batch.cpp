@@ -0,0 +1,228 @@
+#include <map>
+#include <mutex>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <functional>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "batch.hpp"
+#include "bytecode.hpp"
+#include "analysis.hpp"
+#include "pool.hpp"
+#include "io.hpp"
+
+namespace brainfuck
+{
+    std::vector<BatchJob> parse_manifest(std::istream *stream)
+    {
+        std::vector<BatchJob> jobs;
+        std::string line;
+        unsigned long line_number = 0;
+
+        while (std::getline(*stream, line))
+        {
+            line_number++;
+            std::istringstream words(line);
+            std::string command;
+            if (!(words >> command) || command[0] == '#')
+                continue;
+
+            std::string where = "Manifest line " + std::to_string(line_number) + ": ";
+            BatchJob job;
+            if (command == "execute")
+                job.command = BatchCommand::BatchExecute;
+            else if (command == "check_reach")
+                job.command = BatchCommand::BatchCheckReach;
+            else
+                throw ParseException(where + "unknown command \"" + command + "\"");
+
+            if (!(words >> job.program))
+                throw ParseException(where + "missing program");
+
+            std::string word;
+            while (words >> word)
+            {
+                if (word == "--no-change-on-eof")
+                {
+                    job.io_model.set_no_change_on_eof(true);
+                }
+                else if (word == "--max-stdin-length" || word == "--eof-char")
+                {
+                    unsigned long value;
+                    if (!(words >> value))
+                        throw ParseException(where + word + " needs a number");
+                    if (word == "--eof-char")
+                        job.io_model.set_eof_char((uint8_t)value);
+                    else
+                        job.io_model.set_chars_until_eof(value);
+                }
+                else if (word.compare(0, 2, "--") == 0)
+                {
+                    throw ParseException(where + "unknown option " + word);
+                }
+                else if (job.argument.empty())
+                {
+                    job.argument = word;
+                }
+                else
+                {
+                    throw ParseException(where + "unexpected \"" + word + "\"");
+                }
+            }
+
+            if (job.command == BatchCommand::BatchCheckReach && job.argument.empty())
+                throw ParseException(where + "missing label");
+            jobs.push_back(job);
+        }
+        return jobs;
+    }
+
+    std::string json_escape(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '"':
+                escaped += "\\\"";
+                break;
+
+            case '\\':
+                escaped += "\\\\";
+                break;
+
+            case '\n':
+                escaped += "\\n";
+                break;
+
+            case '\t':
+                escaped += "\\t";
+                break;
+
+            default:
+                // Program output is arbitrary bytes, so everything outside
+                // printable ASCII is escaped as a code point
+                if ((unsigned char)c < 0x20 || (unsigned char)c >= 0x7F)
+                {
+                    char code[8];
+                    snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+                    escaped += code;
+                }
+                else
+                {
+                    escaped.push_back(c);
+                }
+            }
+        }
+        return escaped;
+    }
+
+    // Parsed and compiled once by whichever job gets to it first
+    struct SharedProgram
+    {
+        std::once_flag loaded;
+        std::shared_ptr<const Program> prog;
+        std::shared_ptr<const Bytecode> code;
+        std::string error;
+    };
+
+    static void load_program(SharedProgram &shared, const std::string &filename)
+    {
+        try
+        {
+            Program prog = Program::parse_from_file(filename.c_str(), MemoryModel(), IOModel());
+            shared.code = std::make_shared<const Bytecode>(Bytecode::compile(prog));
+            shared.prog = std::make_shared<const Program>(std::move(prog));
+        }
+        catch (ParseException &pe)
+        {
+            shared.error = pe.what();
+        }
+    }
+
+    // Returns the JSON fields describing the result, or throws a
+    // std::runtime_error
+    static std::string execute_job(const BatchJob &job, const SharedProgram &shared, Engine engine)
+    {
+        int fd = -1;
+        if (!job.argument.empty())
+        {
+            fd = open(job.argument.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Could not open input file");
+        }
+
+        MemoryModel memory_model = shared.prog->memory_model;
+        memory_model.reset();
+        FdSource file_input(fd);
+        MemorySource no_input("");
+        InputSource &input = fd >= 0 ? (InputSource &)file_input : (InputSource &)no_input;
+        MemorySink output;
+        shared.code->run(memory_model, job.io_model, input, output, engine);
+        if (fd >= 0)
+            close(fd);
+
+        return "\"input\":\"" + json_escape(job.argument) + "\",\"output\":\"" + json_escape(output.get_data()) + "\"";
+    }
+
+    static std::string check_reach_job(const BatchJob &job, const SharedProgram &shared)
+    {
+        // Spot's BDD library keeps global state and is not thread-safe, so
+        // model checking jobs take turns
+        static std::mutex spot_lock;
+        std::lock_guard<std::mutex> guard(spot_lock);
+
+        Program prog = *shared.prog;
+        prog.io_model = job.io_model;
+        if (!prog.has_label(job.argument))
+            throw std::runtime_error("Label does not exist in the specified program");
+
+        std::string result = "\"label\":\"" + json_escape(job.argument) + "\"";
+        auto m_run = check_reach(prog, job.argument);
+        if (m_run.has_value())
+            return result + ",\"always_reached\":false,\"counterexample\":\"" + json_escape(run_trace(prog, m_run.value())) + "\"";
+        return result + ",\"always_reached\":true";
+    }
+
+    void run_batch(const std::vector<BatchJob> &jobs, unsigned int threads, Engine engine, std::ostream &out)
+    {
+        // All entries exist before the workers start, so they only ever
+        // look up the map and never modify it
+        std::map<std::string, SharedProgram> programs;
+        for (const BatchJob &job : jobs)
+            programs[job.program];
+
+        std::mutex out_lock;
+        WorkStealingPool pool(threads);
+        pool.run(jobs.size(), [&](size_t i)
+                 {
+            const BatchJob &job = jobs[i];
+            SharedProgram &shared = programs.at(job.program);
+            std::call_once(shared.loaded, load_program, std::ref(shared), std::cref(job.program));
+
+            std::string line = "{\"job\":" + std::to_string(i) + ",\"command\":\"" +
+                               (job.command == BatchCommand::BatchExecute ? "execute" : "check_reach") +
+                               "\",\"program\":\"" + json_escape(job.program) + "\",";
+            try
+            {
+                if (!shared.error.empty())
+                    throw std::runtime_error(shared.error);
+                if (job.command == BatchCommand::BatchExecute)
+                    line += execute_job(job, shared, engine);
+                else
+                    line += check_reach_job(job, shared);
+            }
+            catch (const std::exception &e)
+            {
+                line += "\"error\":\"" + json_escape(e.what()) + "\"";
+            }
+            line += "}\n";
+
+            std::lock_guard<std::mutex> guard(out_lock);
+            out << line;
+            out.flush(); });
+    }
+}
\ No newline at end of file
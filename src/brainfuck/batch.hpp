@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "program.hpp"
+#include "model.hpp"
+
+namespace brainfuck
+{
+    enum BatchCommand
+    {
+        BatchExecute,
+        BatchCheckReach
+    };
+
+    struct BatchJob
+    {
+        BatchCommand command;
+        std::string program;
+        // Input file for execute (empty means no input), label for check_reach
+        std::string argument;
+        IOModel io_model;
+    };
+
+    // Reads one job per line, blank lines and lines starting with # are
+    // skipped:
+    //   execute <program> [<stdin file>] [io options]
+    //   check_reach <program> <label> [io options]
+    // where the io options are --max-stdin-length N, --eof-char N and
+    // --no-change-on-eof like on the command line
+    std::vector<BatchJob> parse_manifest(std::istream *stream);
+
+    // Runs all jobs on a work-stealing pool and writes one JSON object per
+    // job to out as soon as it finishes. Jobs on the same program file share
+    // one parsed and compiled program.
+    void run_batch(const std::vector<BatchJob> &jobs, unsigned int threads, Engine engine, std::ostream &out);
+
+    std::string json_escape(const std::string &text);
+}
\ No newline at end of file
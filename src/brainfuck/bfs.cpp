@@ -0,0 +1,538 @@
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include "bfs.hpp"
+#include "kripke.hpp"
+#include "cube.hpp"
+#include "pool.hpp"
+#include "lasso.hpp"
+
+namespace brainfuck
+{
+    static const size_t VISITED_SLOTS = 1 << 10;
+    // States a task of the search expands in one go
+    static const size_t BFS_BLOCK = 256;
+    static const uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+    static const instr_ptr_t NO_PC = std::numeric_limits<instr_ptr_t>::max();
+
+    template <typename T>
+    using ZeroedArray = std::vector<T>;
+
+    static size_t slot_of(shared_state_id_t state, size_t capacity)
+    {
+        uint64_t hash = state * 0x9e3779b97f4a7c15ULL;
+        return (size_t)(hash ^ (hash >> 32)) & (capacity - 1);
+    }
+
+    VisitedSet::VisitedSet()
+    {
+        this->capacity = 0;
+        this->count = 0;
+        this->reserve(VISITED_SLOTS / 2);
+    }
+
+    void VisitedSet::reserve(size_t more)
+    {
+        // Kept at most half full, like the tables of the store
+        size_t needed = (this->count + more) * 2;
+        if (needed <= this->capacity)
+            return;
+        size_t capacity = this->capacity > 0 ? this->capacity : VISITED_SLOTS;
+        while (capacity < needed)
+            capacity *= 2;
+
+        auto keys = std::make_unique<std::atomic<shared_state_id_t>[]>(capacity);
+        auto indices = std::make_unique<uint32_t[]>(capacity);
+        for (size_t slot = 0; slot < capacity; slot++)
+            keys[slot].store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < this->capacity; i++)
+        {
+            shared_state_id_t key = this->keys[i].load(std::memory_order_relaxed);
+            if (key == 0)
+                continue;
+            size_t slot = slot_of(key, capacity);
+            while (keys[slot].load(std::memory_order_relaxed) != 0)
+                slot = (slot + 1) & (capacity - 1);
+            keys[slot].store(key, std::memory_order_relaxed);
+            indices[slot] = this->indices[i];
+        }
+        this->keys.swap(keys);
+        this->indices.swap(indices);
+        this->capacity = capacity;
+    }
+
+    bool VisitedSet::insert(shared_state_id_t state)
+    {
+        shared_state_id_t wanted = state + 1;
+        size_t slot = slot_of(wanted, this->capacity);
+        while (true)
+        {
+            shared_state_id_t key = this->keys[slot].load(std::memory_order_acquire);
+            if (key == wanted)
+                return false;
+            if (key == 0)
+            {
+                // Whoever fills the slot first owns it, everyone else probes on
+                if (this->keys[slot].compare_exchange_strong(key, wanted, std::memory_order_acq_rel))
+                {
+                    this->count++;
+                    return true;
+                }
+                if (key == wanted)
+                    return false;
+            }
+            slot = (slot + 1) & (this->capacity - 1);
+        }
+    }
+
+    size_t VisitedSet::find(shared_state_id_t state) const
+    {
+        size_t slot = slot_of(state + 1, this->capacity);
+        while (true)
+        {
+            shared_state_id_t key = this->keys[slot].load(std::memory_order_acquire);
+            if (key == state + 1)
+                return slot;
+            if (key == 0)
+                return this->capacity;
+            slot = (slot + 1) & (this->capacity - 1);
+        }
+    }
+
+    bool VisitedSet::contains(shared_state_id_t state) const
+    {
+        return this->find(state) != this->capacity;
+    }
+
+    uint32_t VisitedSet::get_index(shared_state_id_t state) const
+    {
+        return this->indices[this->find(state)];
+    }
+
+    void VisitedSet::set_index(shared_state_id_t state, uint32_t index)
+    {
+        this->indices[this->find(state)] = index;
+    }
+
+    size_t VisitedSet::size() const
+    {
+        return this->count;
+    }
+
+    // States of the search, numbered in the order they were found so that
+    // every level is a range of numbers
+    struct SearchGraph
+    {
+        std::vector<shared_state_id_t> ids;
+        std::vector<std::vector<shared_state_id_t>> edges;
+        std::vector<instr_ptr_t> pcs; // NO_PC until expanded
+        std::vector<uint8_t> cut;     // has the label and was never expanded
+    };
+
+    // Calls task on every node in [begin, end), in blocks spread over the pool
+    static void run_blocks(WorkStealingPool &pool, size_t begin, size_t end,
+                           const std::function<void(size_t, unsigned int)> &task)
+    {
+        size_t blocks = (end - begin + BFS_BLOCK - 1) / BFS_BLOCK;
+        pool.run(blocks, [&](size_t block, unsigned int worker)
+                 {
+                     size_t last = std::min(end, begin + (block + 1) * BFS_BLOCK);
+                     for (size_t node = begin + block * BFS_BLOCK; node < last; node++)
+                         task(node, worker); });
+    }
+
+    // A run as the numbers of its states
+    struct Lasso
+    {
+        std::vector<uint32_t> prefix;
+        std::vector<uint32_t> cycle;
+    };
+
+    // Numbers of the successors of every state, for those numbered so far
+    static std::vector<std::vector<uint32_t>> number_edges(const SearchGraph &graph, const VisitedSet &visited,
+                                                           WorkStealingPool &pool)
+    {
+        std::vector<std::vector<uint32_t>> succs(graph.ids.size());
+        run_blocks(pool, 0, graph.ids.size(), [&](size_t node, unsigned int)
+                   {
+                       for (shared_state_id_t state : graph.edges[node])
+                       {
+                           if (visited.contains(state))
+                               succs[node].push_back(visited.get_index(state));
+                       } });
+        return succs;
+    }
+
+    static ReachRun make_run(const SearchGraph &graph, const SharedStateStore &store, const Lasso &lasso)
+    {
+        ReachRun run;
+        for (uint32_t node : lasso.prefix)
+            run.prefix.push_back(store.pack(graph.ids[node]));
+        for (uint32_t node : lasso.cycle)
+            run.cycle.push_back(store.pack(graph.ids[node]));
+        return run;
+    }
+
+    // Shortest run of at most limit states into a cycle of states that
+    // aren't cut. States that weren't expanded yet lead nowhere, so this
+    // finds every such run once all states closer than limit are expanded.
+    // deepest is set to the most steps it takes to reach a state that way,
+    // counting the cut states a breadth-first search would stop at.
+    static std::optional<Lasso> find_lasso(const std::vector<std::vector<uint32_t>> &edges,
+                                           const std::vector<uint8_t> &cut, size_t limit,
+                                           size_t *deepest = nullptr)
+    {
+        size_t count = edges.size();
+        if (deepest != nullptr)
+            *deepest = 0;
+        if (cut[0])
+            return std::nullopt;
+        std::vector<std::vector<uint32_t>> succs(count);
+        for (size_t node = 0; node < count; node++)
+        {
+            if (cut[node])
+                continue;
+            for (uint32_t next : edges[node])
+            {
+                if (!cut[next])
+                    succs[node].push_back(next);
+            }
+        }
+
+        // Depths along runs that stay clear of the cut, which the search
+        // tree doesn't when it went through cut states
+        std::vector<uint32_t> order{0};
+        std::vector<uint32_t> parents(count, NO_NODE);
+        std::vector<size_t> depths(count, 0);
+        std::vector<uint8_t> left(count, 0);
+        left[0] = 1;
+        std::vector<uint8_t> stopped(count, 0);
+        size_t deepest_found = 0;
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            deepest_found = std::max(deepest_found, depths[order[i]]);
+            for (uint32_t next : edges[order[i]])
+            {
+                if (!cut[next] || stopped[next])
+                    continue;
+                stopped[next] = 1;
+                deepest_found = std::max(deepest_found, depths[order[i]] + 1);
+            }
+            for (uint32_t next : succs[order[i]])
+            {
+                if (left[next])
+                    continue;
+                left[next] = 1;
+                parents[next] = order[i];
+                depths[next] = depths[order[i]] + 1;
+                order.push_back(next);
+            }
+        }
+        if (deepest != nullptr)
+            *deepest = deepest_found;
+
+        // Peel off states that have to reach the label, and then those that
+        // no cycle leads to, until every state left has both. Whatever is
+        // left after the first round leads to a cycle.
+        std::vector<uint32_t> out_degree(count, 0);
+        std::vector<uint32_t> in_degree(count, 0);
+        std::vector<std::vector<uint32_t>> preds(count);
+        for (uint32_t node : order)
+        {
+            out_degree[node] = succs[node].size();
+            for (uint32_t next : succs[node])
+            {
+                preds[next].push_back(node);
+                in_degree[next]++;
+            }
+        }
+        std::vector<uint32_t> work;
+        for (uint32_t node : order)
+        {
+            if (out_degree[node] == 0)
+                work.push_back(node);
+        }
+        while (!work.empty())
+        {
+            uint32_t node = work.back();
+            work.pop_back();
+            left[node] = 0;
+            for (uint32_t pred : preds[node])
+            {
+                if (--out_degree[pred] == 0)
+                    work.push_back(pred);
+            }
+        }
+        if (!left[0])
+            return std::nullopt;
+
+        for (uint32_t node : order)
+        {
+            if (left[node] && in_degree[node] == 0)
+                work.push_back(node);
+        }
+        while (!work.empty())
+        {
+            uint32_t node = work.back();
+            work.pop_back();
+            left[node] = 0;
+            for (uint32_t next : succs[node])
+            {
+                if (left[next] && --in_degree[next] == 0)
+                    work.push_back(next);
+            }
+        }
+
+        std::vector<uint64_t> succ_start(count + 1, 0);
+        std::vector<uint32_t> flat;
+        for (size_t node = 0; node < count; node++)
+        {
+            flat.insert(flat.end(), succs[node].begin(), succs[node].end());
+            succ_start[node + 1] = flat.size();
+        }
+        std::vector<uint32_t> best_cycle = find_cycle<ZeroedArray>(count, succ_start, flat, left, depths, limit);
+        if (best_cycle.empty())
+            return std::nullopt;
+
+        // Along the search tree to the first state of the cycle
+        Lasso lasso;
+        for (uint32_t node = parents[best_cycle.front()]; node != NO_NODE; node = parents[node])
+            lasso.prefix.push_back(node);
+        std::reverse(lasso.prefix.begin(), lasso.prefix.end());
+        lasso.cycle = best_cycle;
+        return lasso;
+    }
+
+    // A search that goes one level at a time on all threads
+    struct LevelSearch
+    {
+        KProgram kprog;
+        WorkStealingPool pool;
+        std::vector<KCubeThread> workers;
+        SharedStateStore store;
+        VisitedSet visited;
+        SearchGraph graph;
+        size_t level_start; // first state that hasn't been expanded
+        size_t depth;       // levels expanded so far
+
+        LevelSearch(const Program &prog, bool abstract_input, unsigned int threads);
+    };
+
+    static PackedState initial_state(const KProgram &kprog)
+    {
+        PackedState initial;
+        initial.header = StateHeader{0, 0, std::nullopt};
+        if (kprog.chars_until_eof.has_value())
+            initial.header.remaining_stdin_chars = (unsigned int)kprog.chars_until_eof.value();
+        return initial;
+    }
+
+    LevelSearch::LevelSearch(const Program &prog, bool abstract_input, unsigned int threads)
+        : kprog(prog, abstract_input), pool(threads), store(KRIPKE_MEMORY_SIZE)
+    {
+        this->workers.resize(this->pool.get_threads());
+        shared_state_id_t root = this->store.unpack(initial_state(this->kprog));
+        this->visited.insert(root);
+        this->visited.set_index(root, 0);
+        this->graph.ids.push_back(root);
+        this->graph.edges.resize(1);
+        this->graph.pcs.resize(1, NO_PC);
+        this->graph.cut.resize(1, 0);
+        this->level_start = 0;
+        this->depth = 0;
+    }
+
+    // Expands every state of the level except those at a pc in targets,
+    // which are cut instead. Returns the first state that loops back to
+    // itself, like every state where the program has ended, if any.
+    static uint32_t expand_level(LevelSearch &search, const std::vector<bool> &targets)
+    {
+        SearchGraph &graph = search.graph;
+        std::atomic<uint32_t> looping(NO_NODE);
+        run_blocks(search.pool, search.level_start, graph.ids.size(), [&](size_t node, unsigned int worker)
+                   {
+                       instr_ptr_t pc = search.store.get_header(graph.ids[node]).pc;
+                       graph.pcs[node] = pc;
+                       if (targets[std::min<size_t>(pc, search.kprog.ops.size())])
+                       {
+                           graph.cut[node] = 1;
+                           return;
+                       }
+                       KCubeThread &thread = search.workers[worker];
+                       shared_successors(search.kprog, search.store, thread, graph.ids[node]);
+                       graph.edges[node] = thread.shared;
+                       const auto &edges = graph.edges[node];
+                       if (std::find(edges.begin(), edges.end(), graph.ids[node]) == edges.end())
+                           return;
+                       uint32_t current = looping.load();
+                       while (node < current && !looping.compare_exchange_weak(current, (uint32_t)node))
+                       {
+                       } });
+        return looping.load();
+    }
+
+    // Numbers the successors of the level that are new, after the level is
+    // done so that numbers stay in order of depth, and moves on to them
+    static void add_level(LevelSearch &search)
+    {
+        SearchGraph &graph = search.graph;
+        size_t level_end = graph.ids.size();
+        size_t found = 0;
+        for (size_t node = search.level_start; node < level_end; node++)
+            found += graph.edges[node].size();
+        search.visited.reserve(found);
+
+        std::vector<std::vector<shared_state_id_t>> discovered(search.workers.size());
+        run_blocks(search.pool, search.level_start, level_end, [&](size_t node, unsigned int worker)
+                   {
+                       for (shared_state_id_t state : graph.edges[node])
+                       {
+                           if (search.visited.insert(state))
+                               discovered[worker].push_back(state);
+                       } });
+        for (const auto &states : discovered)
+        {
+            for (shared_state_id_t state : states)
+            {
+                search.visited.set_index(state, graph.ids.size());
+                graph.ids.push_back(state);
+            }
+        }
+        graph.edges.resize(graph.ids.size());
+        graph.pcs.resize(graph.ids.size(), NO_PC);
+        graph.cut.resize(graph.ids.size(), 0);
+        search.level_start = level_end;
+        search.depth++;
+    }
+
+    static std::vector<bool> label_targets(const Program &prog, const std::string &label)
+    {
+        std::vector<bool> targets(prog.get_instructions().size() + 1, false);
+        for (const auto &kv : prog.get_label_map())
+        {
+            if (kv.second == label)
+                targets[kv.first] = true;
+        }
+        return targets;
+    }
+
+    std::optional<ReachRun> bfs_reach(const Program &prog, const std::string &label, bool abstract_input,
+                                      const ReachOptions &options, bool *bounded)
+    {
+        LevelSearch search(prog, abstract_input, options.threads);
+        const SearchGraph &graph = search.graph;
+        std::vector<bool> targets = label_targets(prog, label);
+        auto find = [&](size_t limit) -> std::optional<ReachRun>
+        {
+            auto m_lasso = find_lasso(number_edges(graph, search.visited, search.pool), graph.cut, limit);
+            if (!m_lasso.has_value())
+                return std::nullopt;
+            return make_run(graph, search.store, m_lasso.value());
+        };
+
+        // Every run of up to depth states is in the graph after depth
+        // levels. Deepening looks for runs whenever the depth doubles.
+        size_t max_depth = options.max_depth.has_value() ? options.max_depth.value() : std::numeric_limits<size_t>::max();
+        size_t next_check = 1;
+        if (bounded != nullptr)
+            *bounded = false;
+
+        while (search.level_start < graph.ids.size())
+        {
+            if (search.depth >= max_depth)
+            {
+                auto m_run = find(max_depth);
+                if (bounded != nullptr && !m_run.has_value())
+                    *bounded = true;
+                return m_run;
+            }
+
+            // A loop makes a run of depth + 1 states, and every run up to
+            // that length is in the graph by now
+            if (expand_level(search, targets) != NO_NODE)
+                return find(search.depth + 1);
+            add_level(search);
+
+            if (options.iterative_deepening && search.depth == next_check && search.depth < max_depth)
+            {
+                next_check *= 2;
+                auto m_run = find(search.depth);
+                if (m_run.has_value())
+                    return m_run;
+            }
+        }
+
+        // Every state has been expanded, so any run will do
+        return find(std::numeric_limits<size_t>::max());
+    }
+
+    StateSpace bfs_explore(const Program &prog, bool abstract_input, const ReachOptions &options)
+    {
+        LevelSearch search(prog, abstract_input, options.threads);
+        const SearchGraph &graph = search.graph;
+        std::vector<bool> none(search.kprog.ops.size() + 1, false);
+        size_t max_depth = options.max_depth.has_value() ? options.max_depth.value() : std::numeric_limits<size_t>::max();
+        while (search.level_start < graph.ids.size() && search.depth < max_depth)
+        {
+            expand_level(search, none);
+            add_level(search);
+        }
+
+        StateSpace space;
+        space.abstract_input = abstract_input;
+        space.pcs = graph.pcs;
+        space.successors = number_edges(graph, search.visited, search.pool);
+        space.depth = search.depth;
+        space.complete = search.level_start == graph.ids.size();
+        space.max_depth = options.max_depth;
+        return space;
+    }
+
+    std::optional<ReachRun> space_reach(const Program &prog, const StateSpace &space, const std::string &label,
+                                        bool *bounded)
+    {
+        std::vector<bool> targets = label_targets(prog, label);
+        std::vector<uint8_t> cut(space.successors.size(), 0);
+        for (size_t node = 0; node < cut.size(); node++)
+        {
+            if (!space.successors[node].empty())
+                cut[node] = targets[std::min<size_t>(space.pcs[node], targets.size() - 1)] ? 1 : 0;
+        }
+        // bfs_reach takes any run once it found every state clear of the
+        // label, and only runs of up to max_depth states if it stopped
+        // first. Those states can be deeper than the levels explored here,
+        // as the label doesn't stand in front of them in this space.
+        size_t max_depth = space.max_depth.has_value() ? space.max_depth.value() : std::numeric_limits<size_t>::max();
+        size_t deepest = 0;
+        auto m_lasso = find_lasso(space.successors, cut, std::numeric_limits<size_t>::max(), &deepest);
+        bool stopped = deepest >= max_depth;
+        if (m_lasso.has_value() && stopped &&
+            m_lasso.value().prefix.size() + m_lasso.value().cycle.size() > max_depth)
+            m_lasso.reset();
+        if (bounded != nullptr)
+            *bounded = !m_lasso.has_value() && stopped;
+        if (!m_lasso.has_value())
+            return std::nullopt;
+
+        // The states themselves come from taking the same successors again
+        KProgram kprog(prog, space.abstract_input);
+        StateStore store(KRIPKE_MEMORY_SIZE);
+        std::vector<uint32_t> nodes(m_lasso.value().prefix);
+        nodes.insert(nodes.end(), m_lasso.value().cycle.begin(), m_lasso.value().cycle.end());
+        std::vector<state_id_t> ids{store.unpack(initial_state(kprog))};
+        std::vector<state_id_t> found;
+        for (size_t i = 1; i < nodes.size(); i++)
+        {
+            const auto &succs = space.successors[nodes[i - 1]];
+            size_t position = std::find(succs.begin(), succs.end(), nodes[i]) - succs.begin();
+            found.clear();
+            successors(kprog, store, ids.back(), found, nullptr);
+            ids.push_back(found[position]);
+        }
+
+        ReachRun run;
+        for (size_t i = 0; i < ids.size(); i++)
+            (i < m_lasso.value().prefix.size() ? run.prefix : run.cycle).push_back(store.pack(ids[i]));
+        return run;
+    }
+}
\ No newline at end of file
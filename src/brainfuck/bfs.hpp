@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <stdint.h>
+#include "program.hpp"
+#include "store.hpp"
+#include "analysis.hpp"
+
+namespace brainfuck
+{
+    // Set of shared state ids that any number of threads can add to at once
+    // without locks, each id with an index that is set later. It never grows
+    // while in use, so room has to be made up front.
+    class VisitedSet
+    {
+    private:
+        size_t capacity;
+        std::unique_ptr<std::atomic<shared_state_id_t>[]> keys; // id + 1, 0 if empty
+        std::unique_ptr<uint32_t[]> indices;
+        std::atomic<size_t> count;
+
+        size_t find(shared_state_id_t state) const;
+
+    public:
+        VisitedSet();
+        // Makes room for this many more ids. Not safe while adding.
+        void reserve(size_t more);
+        // True if the id wasn't in the set yet
+        bool insert(shared_state_id_t state);
+        bool contains(shared_state_id_t state) const;
+        // Only for ids in the set, and not safe while adding
+        uint32_t get_index(shared_state_id_t state) const;
+        void set_index(shared_state_id_t state, uint32_t index);
+        size_t size() const;
+    };
+
+    // A run that never reaches a label, the cycle repeating forever. A run
+    // that ends has the state it ended in as its whole cycle. Its length is
+    // the number of states in prefix and cycle together.
+    struct ReachRun
+    {
+        std::vector<PackedState> prefix;
+        std::vector<PackedState> cycle;
+    };
+
+    // Looks for a run that never reaches the label with a breadth-first
+    // search that expands one level at a time on all threads. States with
+    // the label are never expanded, as every run through them is fine, so
+    // such a run is a path to a cycle among the states that are left. The
+    // run found is one of the shortest, unless the cycles are in large
+    // tangles of states where looking for a shorter one gives up after time
+    // linear in the graph. With options.max_depth only runs up to that
+    // length are looked for, and bounded is set if none was found while
+    // states past it were left out.
+    std::optional<ReachRun> bfs_reach(const Program &prog, const std::string &label, bool abstract_input,
+                                      const ReachOptions &options, bool *bounded = nullptr);
+
+    // Every state a breadth-first search that cuts nothing found, numbered
+    // in order of depth from the initial state 0, with the numbers of the
+    // successors of each in the order successors gives them. States past
+    // options.max_depth were never expanded and have neither successors
+    // nor a pc. Nothing in it depends on a label.
+    struct StateSpace
+    {
+        bool abstract_input;
+        std::vector<instr_ptr_t> pcs;
+        std::vector<std::vector<uint32_t>> successors;
+        size_t depth;  // levels that were expanded
+        bool complete; // every state was expanded
+        std::optional<unsigned int> max_depth; // of the options it was explored with
+    };
+
+    StateSpace bfs_explore(const Program &prog, bool abstract_input, const ReachOptions &options);
+
+    // bfs_reach on a state space that was explored before, for any label.
+    // The states of the run are computed again from the program.
+    std::optional<ReachRun> space_reach(const Program &prog, const StateSpace &space, const std::string &label,
+                                        bool *bounded = nullptr);
+}
\ No newline at end of file
@@ -1,6 +1,22 @@
 #pragma once
 
 #include "program.hpp"
+#include "lexer.hpp"
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include "codegen.hpp"
+#include "profile.hpp"
+#include "io.hpp"
+#include "store.hpp"
+#include "classes.hpp"
 #include "kripke.hpp"
+#include "cube.hpp"
+#include "bfs.hpp"
+#include "external.hpp"
+#include "approx.hpp"
+#include "cache.hpp"
+#include "flow.hpp"
 #include "model.hpp"
-#include "analysis.hpp"
\ No newline at end of file
+#include "analysis.hpp"
+#include "pool.hpp"
+#include "batch.hpp"
\ No newline at end of file
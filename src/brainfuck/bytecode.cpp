@@ -0,0 +1,527 @@
+#include <map>
+#include <stack>
+#include <vector>
+#include <stdlib.h>
+#include "bytecode.hpp"
+#include "jit.hpp"
+#include "scan.hpp"
+
+namespace brainfuck
+{
+    Bytecode::Bytecode()
+    {
+    }
+
+    const std::vector<ByteOp> &Bytecode::get_ops() const
+    {
+        return this->ops;
+    }
+
+    instr_ptr_t Bytecode::source_pc(size_t ip) const
+    {
+        return this->source_pcs.at(ip);
+    }
+
+    void Bytecode::emit(OpCode code, long arg, long offset, instr_ptr_t pc)
+    {
+        // A set followed by an add can never be a jump target, so we fold them
+        if (code == OpCode::op_add && !this->ops.empty() && this->ops.back().code == OpCode::op_set)
+        {
+            this->ops.back().arg += arg;
+            return;
+        }
+        this->ops.push_back(ByteOp{code, arg, offset});
+        this->source_pcs.push_back(pc);
+    }
+
+    // Turns loops like [-], [->+<] or [->++>+++<<] into closed-form operations.
+    // Only loops without I/O, without nested loops and without net pointer
+    // movement qualify. Returns false if the loop has to be compiled normally.
+    bool Bytecode::compile_simple_loop(
+        const std::vector<Instruction> &instrs,
+        instr_ptr_t start,
+        instr_ptr_t end,
+        const MemoryModel &memory_model)
+    {
+        std::map<long, long> deltas;
+        long offset = 0, min_offset = 0, max_offset = 0;
+        bool has_moves = false;
+
+        for (instr_ptr_t pc = start + 1; pc < end; pc++)
+        {
+            switch (instrs[pc])
+            {
+            case Instruction::left:
+                offset--;
+                has_moves = true;
+                break;
+
+            case Instruction::right:
+                offset++;
+                has_moves = true;
+                break;
+
+            case Instruction::inc:
+                deltas[offset]++;
+                break;
+
+            case Instruction::dec:
+                deltas[offset]--;
+                break;
+
+            default:
+                return false;
+            }
+            min_offset = std::min(min_offset, offset);
+            max_offset = std::max(max_offset, offset);
+        }
+
+        long memory_size = (long)memory_model.get_memory_size();
+        bool has_adds = false;
+        for (const auto &kv : deltas)
+        {
+            if (kv.second != 0)
+                has_adds = true;
+        }
+
+        // Loops like [>] or [<<] only search for a zero cell
+        if (offset != 0)
+        {
+            if (has_adds || !memory_model.is_wrapping())
+                return false;
+            long stride = offset;
+            if (stride >= memory_size || -stride >= memory_size)
+                stride = ((stride % memory_size) + memory_size) % memory_size;
+            if (stride == 0)
+                return false;
+            this->emit(OpCode::op_scan, stride, 0, start);
+            return true;
+        }
+
+        // Offsets can only be resolved statically if the pointer wraps and
+        // all touched cells are distinct
+        if (has_moves && (!memory_model.is_wrapping() || max_offset - min_offset >= memory_size))
+            return false;
+
+        long counter = deltas.count(0) > 0 ? deltas[0] : 0;
+        bool has_targets = false;
+        for (const auto &kv : deltas)
+        {
+            if (kv.first != 0 && kv.second != 0)
+                has_targets = true;
+        }
+
+        // Cells wrap around at a power of two, so any odd step reaches zero
+        if (!has_targets && counter % 2 != 0)
+        {
+            this->emit(OpCode::op_set, 0, 0, start);
+            return true;
+        }
+
+        if (counter != 1 && counter != -1)
+            return false;
+
+        // The loop runs cell times when counting down and -cell times when
+        // counting up, which is the same modulo the cell size
+        for (const auto &kv : deltas)
+        {
+            if (kv.first == 0 || kv.second == 0)
+                continue;
+            long factor = counter == -1 ? kv.second : -kv.second;
+            long target = ((kv.first % memory_size) + memory_size) % memory_size;
+            this->emit(OpCode::op_mul, factor, target, start);
+        }
+        this->emit(OpCode::op_set, 0, 0, start);
+        return true;
+    }
+
+    Bytecode Bytecode::compile(const Program &prog)
+    {
+        Bytecode code;
+        const std::vector<Instruction> &instrs = prog.get_instructions();
+        const MemoryModel &memory_model = prog.memory_model;
+        bool wrapping = memory_model.is_wrapping();
+        long memory_size = (long)memory_model.get_memory_size();
+
+        std::vector<instr_ptr_t> matching(instrs.size());
+        std::stack<instr_ptr_t> fwd_stack;
+        for (instr_ptr_t pc = 0; pc < instrs.size(); pc++)
+        {
+            if (instrs[pc] == Instruction::fwd)
+            {
+                fwd_stack.push(pc);
+            }
+            else if (instrs[pc] == Instruction::bwd)
+            {
+                matching[pc] = fwd_stack.top();
+                matching[fwd_stack.top()] = pc;
+                fwd_stack.pop();
+            }
+        }
+
+        std::stack<size_t> loop_stack;
+        instr_ptr_t pc = 0;
+        while (pc < instrs.size())
+        {
+            Instruction instr = instrs[pc];
+            instr_ptr_t start = pc;
+            long amount = 0;
+
+            switch (instr)
+            {
+            case Instruction::inc:
+            case Instruction::dec:
+                while (pc < instrs.size() && (instrs[pc] == Instruction::inc || instrs[pc] == Instruction::dec))
+                {
+                    amount += instrs[pc] == Instruction::inc ? 1 : -1;
+                    pc++;
+                }
+                if (amount != 0)
+                    code.emit(OpCode::op_add, amount, 0, start);
+                break;
+
+            case Instruction::left:
+            case Instruction::right:
+                // Without wrapping the pointer sticks to the tape's ends, so
+                // only moves in the same direction can be merged
+                while (pc < instrs.size() && (instrs[pc] == instr || (wrapping && (instrs[pc] == Instruction::left || instrs[pc] == Instruction::right))))
+                {
+                    amount += instrs[pc] == Instruction::right ? 1 : -1;
+                    pc++;
+                }
+                if (wrapping)
+                    amount = ((amount % memory_size) + memory_size) % memory_size;
+                if (amount != 0)
+                    code.emit(OpCode::op_move, amount, 0, start);
+                break;
+
+            case Instruction::get:
+                code.emit(OpCode::op_get, 0, 0, pc);
+                pc++;
+                break;
+
+            case Instruction::put:
+                code.emit(OpCode::op_put, 0, 0, pc);
+                pc++;
+                break;
+
+            case Instruction::fwd:
+                if (code.compile_simple_loop(instrs, pc, matching[pc], memory_model))
+                {
+                    pc = matching[pc] + 1;
+                }
+                else
+                {
+                    loop_stack.push(code.ops.size());
+                    code.emit(OpCode::op_jz, 0, 0, pc);
+                    pc++;
+                }
+                break;
+
+            case Instruction::bwd:
+                code.emit(OpCode::op_jnz, (long)loop_stack.top() + 1, 0, pc);
+                code.ops[loop_stack.top()].arg = (long)code.ops.size();
+                loop_stack.pop();
+                pc++;
+                break;
+
+            default:
+                abort();
+            }
+        }
+        code.emit(OpCode::op_halt, 0, 0, instrs.size());
+
+        return code;
+    }
+
+    static inline mem_ptr_t move_pointer(
+        mem_ptr_t ptr, long offset, memory_size_t memory_size, bool wrapping)
+    {
+        // Wrapping offsets have already been reduced to [0, memory_size)
+        if (wrapping)
+        {
+            ptr += (mem_ptr_t)offset;
+            return ptr >= memory_size ? ptr - memory_size : ptr;
+        }
+        else if (offset < 0)
+        {
+            return ptr > (mem_ptr_t)-offset ? ptr + offset : 0;
+        }
+        else
+        {
+            return memory_size - 1 - ptr > (mem_ptr_t)offset ? ptr + offset : memory_size - 1;
+        }
+    }
+
+    template <bool Dense, typename Cell>
+    static inline mem_ptr_t scan_tape(Tape<Cell> &tape, mem_ptr_t ptr, long stride)
+    {
+        if constexpr (Dense)
+            return scan_zero(tape.data(), tape.get_size(), ptr, stride);
+
+        memory_size_t memory_size = tape.get_size();
+        mem_ptr_t step = stride > 0 ? (mem_ptr_t)stride : (mem_ptr_t)-stride;
+        while (tape.get(ptr) != 0)
+        {
+            if (stride > 0)
+                ptr = ptr + step >= memory_size ? ptr + step - memory_size : ptr + step;
+            else
+                ptr = ptr >= step ? ptr - step : ptr + memory_size - step;
+        }
+        return ptr;
+    }
+
+    template <bool Dense, typename Cell>
+    static mem_ptr_t interpret_switch(
+        const std::vector<ByteOp> &code,
+        Tape<Cell> &tape,
+        mem_ptr_t ptr,
+        bool wrapping,
+        IOChannel &io)
+    {
+        const ByteOp *ops = code.data();
+        memory_size_t memory_size = tape.get_size();
+        size_t ip = 0;
+        Cell value;
+        mem_ptr_t target;
+
+        while (true)
+        {
+            const ByteOp &op = ops[ip];
+            switch (op.code)
+            {
+            case OpCode::op_add:
+                tape.template at<Dense>(ptr) += (Cell)op.arg;
+                ip++;
+                break;
+
+            case OpCode::op_move:
+                ptr = move_pointer(ptr, op.arg, memory_size, wrapping);
+                ip++;
+                break;
+
+            case OpCode::op_set:
+                tape.template at<Dense>(ptr) = (Cell)op.arg;
+                ip++;
+                break;
+
+            case OpCode::op_mul:
+                value = tape.template at<Dense>(ptr);
+                target = ptr + (mem_ptr_t)op.offset;
+                if (target >= memory_size)
+                    target -= memory_size;
+                tape.template at<Dense>(target) += (Cell)((uint32_t)value * (uint32_t)op.arg);
+                ip++;
+                break;
+
+            case OpCode::op_scan:
+                ptr = scan_tape<Dense>(tape, ptr, op.arg);
+                ip++;
+                break;
+
+            case OpCode::op_get:
+                tape.template at<Dense>(ptr) = (Cell)io.read(tape.template at<Dense>(ptr));
+                ip++;
+                break;
+
+            case OpCode::op_put:
+                io.write((uint8_t)tape.template at<Dense>(ptr));
+                ip++;
+                break;
+
+            case OpCode::op_jz:
+                if (tape.template at<Dense>(ptr) == 0)
+                    ip = (size_t)op.arg;
+                else
+                    ip++;
+                break;
+
+            case OpCode::op_jnz:
+                if (tape.template at<Dense>(ptr) != 0)
+                    ip = (size_t)op.arg;
+                else
+                    ip++;
+                break;
+
+            case OpCode::op_halt:
+                return ptr;
+
+            default:
+                abort();
+            }
+        }
+    }
+
+#ifdef BRAINCHECK_COMPUTED_GOTO
+// Labels as values are a GNU extension
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+    // Every op carries the address of its handler, and every handler ends in
+    // its own indirect jump to the next one. This gives the branch predictor
+    // one jump site per opcode instead of a single shared one.
+    template <bool Dense, typename Cell>
+    static mem_ptr_t interpret_threaded(
+        const std::vector<ByteOp> &code,
+        Tape<Cell> &tape,
+        mem_ptr_t ptr,
+        bool wrapping,
+        IOChannel &io)
+    {
+        static const void *const handlers[] = {
+            &&do_add,
+            &&do_move,
+            &&do_set,
+            &&do_mul,
+            &&do_scan,
+            &&do_get,
+            &&do_put,
+            &&do_jz,
+            &&do_jnz,
+            &&do_halt};
+
+        struct ThreadedOp
+        {
+            const void *handler;
+            long arg;
+            long offset;
+        };
+
+        std::vector<ThreadedOp> threaded;
+        threaded.reserve(code.size());
+        for (const ByteOp &op : code)
+            threaded.push_back(ThreadedOp{handlers[op.code], op.arg, op.offset});
+
+        const ThreadedOp *ops = threaded.data();
+        const ThreadedOp *ip = ops;
+        memory_size_t memory_size = tape.get_size();
+        Cell value;
+        mem_ptr_t target;
+
+#define DISPATCH() goto *ip->handler
+        DISPATCH();
+
+    do_add:
+        tape.template at<Dense>(ptr) += (Cell)ip->arg;
+        ip++;
+        DISPATCH();
+
+    do_move:
+        ptr = move_pointer(ptr, ip->arg, memory_size, wrapping);
+        ip++;
+        DISPATCH();
+
+    do_set:
+        tape.template at<Dense>(ptr) = (Cell)ip->arg;
+        ip++;
+        DISPATCH();
+
+    do_mul:
+        value = tape.template at<Dense>(ptr);
+        target = ptr + (mem_ptr_t)ip->offset;
+        if (target >= memory_size)
+            target -= memory_size;
+        tape.template at<Dense>(target) += (Cell)((uint32_t)value * (uint32_t)ip->arg);
+        ip++;
+        DISPATCH();
+
+    do_scan:
+        ptr = scan_tape<Dense>(tape, ptr, ip->arg);
+        ip++;
+        DISPATCH();
+
+    do_get:
+        tape.template at<Dense>(ptr) = (Cell)io.read(tape.template at<Dense>(ptr));
+        ip++;
+        DISPATCH();
+
+    do_put:
+        io.write((uint8_t)tape.template at<Dense>(ptr));
+        ip++;
+        DISPATCH();
+
+    do_jz:
+        if (tape.template at<Dense>(ptr) == 0)
+            ip = ops + ip->arg;
+        else
+            ip++;
+        DISPATCH();
+
+    do_jnz:
+        if (tape.template at<Dense>(ptr) != 0)
+            ip = ops + ip->arg;
+        else
+            ip++;
+        DISPATCH();
+
+    do_halt:
+        return ptr;
+#undef DISPATCH
+    }
+
+#pragma GCC diagnostic pop
+#else
+    template <bool Dense, typename Cell>
+    static mem_ptr_t interpret_threaded(
+        const std::vector<ByteOp> &code,
+        Tape<Cell> &tape,
+        mem_ptr_t ptr,
+        bool wrapping,
+        IOChannel &io)
+    {
+        return interpret_switch<Dense>(code, tape, ptr, wrapping, io);
+    }
+#endif
+
+    template <bool Dense, typename Cell>
+    static mem_ptr_t interpret(
+        Engine engine,
+        const std::vector<ByteOp> &code,
+        Tape<Cell> &tape,
+        mem_ptr_t ptr,
+        bool wrapping,
+        IOChannel &io)
+    {
+        switch (engine)
+        {
+        case Engine::SwitchDispatch:
+            return interpret_switch<Dense>(code, tape, ptr, wrapping, io);
+
+        case Engine::ThreadedDispatch:
+        case Engine::Jit:
+            return interpret_threaded<Dense>(code, tape, ptr, wrapping, io);
+
+        default:
+            abort();
+        }
+    }
+
+    void Bytecode::run(
+        MemoryModel &memory_model,
+        const IOModel &io_model,
+        InputSource &input,
+        OutputSink &output,
+        Engine engine) const
+    {
+        IOChannel io(input, output, io_model);
+        if (engine == Engine::Jit && run_jit(this->ops, memory_model, io))
+        {
+            io.flush();
+            return;
+        }
+
+        mem_ptr_t ptr = memory_model.get_pointer();
+        bool wrapping = memory_model.is_wrapping();
+
+        // Dispatch on cell size and storage once instead of for every op
+        memory_model.visit_tape([&](auto &tape)
+                                {
+            tape.materialize();
+            if (tape.is_dense())
+                ptr = interpret<true>(engine, this->ops, tape, ptr, wrapping, io);
+            else
+                ptr = interpret<false>(engine, this->ops, tape, ptr, wrapping, io); });
+        memory_model.set_pointer(ptr);
+        io.flush();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include "io.hpp"
+#include "model.hpp"
+#include "program.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BRAINCHECK_COMPUTED_GOTO
+#endif
+
+namespace brainfuck
+{
+    enum OpCode : uint8_t
+    {
+        op_add,  // cell += arg
+        op_move, // ptr += arg
+        op_set,  // cell = arg
+        op_mul,  // cell[ptr + offset] += cell * arg
+        op_scan, // ptr += arg until cell == 0
+        op_get,  // cell = next char
+        op_put,  // print cell
+        op_jz,   // if cell == 0 jump to arg
+        op_jnz,  // if cell != 0 jump to arg
+        op_halt
+    };
+
+    struct ByteOp
+    {
+        OpCode code;
+        long arg;
+        long offset;
+    };
+
+    class Bytecode
+    {
+    private:
+        std::vector<ByteOp> ops;
+        std::vector<instr_ptr_t> source_pcs;
+        void emit(OpCode code, long arg, long offset, instr_ptr_t pc);
+        bool compile_simple_loop(const std::vector<Instruction> &instrs, instr_ptr_t start, instr_ptr_t end, const MemoryModel &memory_model);
+
+    public:
+        Bytecode();
+        const std::vector<ByteOp> &get_ops() const;
+        instr_ptr_t source_pc(size_t ip) const;
+        void run(MemoryModel &memory_model, const IOModel &io_model, InputSource &input, OutputSink &output, Engine engine = Engine::ThreadedDispatch) const;
+        static Bytecode compile(const Program &prog);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cache.hpp"
+
+namespace brainfuck
+{
+    // Part of every key, to be changed whenever the files change shape
+    static const char *CACHE_VERSION = "braincheck cache 1";
+
+    static uint64_t fnv1a(const char *data, size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ (uint8_t)data[i]) * 0x100000001b3ULL;
+        return hash;
+    }
+
+    template <typename T>
+    static void put_value(std::string &out, T value)
+    {
+        out.append((const char *)&value, sizeof(value));
+    }
+
+    // Reads a payload front to back, failing instead of reading past it
+    class PayloadReader
+    {
+    private:
+        const std::string &data;
+        size_t pos;
+
+    public:
+        PayloadReader(const std::string &data) : data(data), pos(0) {}
+
+        template <typename T>
+        bool get(T &value)
+        {
+            if (this->data.size() - this->pos < sizeof(value))
+                return false;
+            memcpy(&value, this->data.data() + this->pos, sizeof(value));
+            this->pos += sizeof(value);
+            return true;
+        }
+
+        // The next length bytes, nullptr if there aren't that many
+        const uint8_t *take(size_t length)
+        {
+            if (this->data.size() - this->pos < length)
+                return nullptr;
+            const uint8_t *bytes = (const uint8_t *)this->data.data() + this->pos;
+            this->pos += length;
+            return bytes;
+        }
+
+        bool done() const
+        {
+            return this->pos == this->data.size();
+        }
+    };
+
+    // Everything about a check the state space depends on
+    static std::string space_key(const Program &prog, bool abstract_input, const ReachOptions &options)
+    {
+        std::ostringstream key;
+        key << CACHE_VERSION << '\n';
+        for (Instruction instr : prog.get_instructions())
+            key << instr_char(instr);
+        key << '\n';
+        // Labels decide which pcs get states of their own
+        for (const auto &kv : prog.get_label_map())
+            key << "label " << kv.first << ' ' << kv.second << '\n';
+        auto chars_until_eof = prog.io_model.get_chars_until_eof();
+        key << "stdin " << (chars_until_eof.has_value() ? std::to_string(chars_until_eof.value()) : "unlimited") << '\n';
+        key << "eof " << (unsigned int)prog.io_model.get_eof_char();
+        key << (prog.io_model.get_no_change_on_eof() ? " unchanged" : "") << '\n';
+        key << "abstract " << (abstract_input ? 1 : 0) << '\n';
+        auto max_depth = options.max_depth;
+        key << "depth " << (max_depth.has_value() ? std::to_string(max_depth.value()) : "unlimited") << '\n';
+        return key.str();
+    }
+
+    static std::string verdict_key(const Program &prog, const std::string &label, const ReachOptions &options)
+    {
+        return space_key(prog, options.abstract_input, options) + "reach " + label + '\n';
+    }
+
+    static void put_states(std::string &out, const std::vector<PackedState> &states)
+    {
+        std::vector<uint8_t> bytes;
+        put_value(out, (uint32_t)states.size());
+        for (const PackedState &state : states)
+        {
+            bytes.clear();
+            encode_state(state, bytes);
+            put_value(out, (uint32_t)bytes.size());
+            out.append((const char *)bytes.data(), bytes.size());
+        }
+    }
+
+    static bool get_states(PayloadReader &reader, std::vector<PackedState> &states)
+    {
+        uint32_t count;
+        if (!reader.get(count))
+            return false;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t length;
+            const uint8_t *bytes;
+            if (!reader.get(length) || (bytes = reader.take(length)) == nullptr)
+                return false;
+            states.push_back(decode_state(bytes));
+        }
+        return true;
+    }
+
+    ResultCache::ResultCache(std::string directory)
+    {
+        this->directory = directory;
+        if (mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST)
+            throw CacheException("Could not create the cache directory " + directory);
+    }
+
+    std::string ResultCache::path_for(const std::string &key, const char *kind) const
+    {
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)fnv1a(key.data(), key.size()));
+        return this->directory + "/" + name + "." + kind;
+    }
+
+    // A file holds the length of its key, the key, the payload and a hash
+    // of all of these
+    std::optional<std::string> ResultCache::load(const std::string &key, const char *kind) const
+    {
+        std::ifstream file(this->path_for(key, kind), std::ios::binary);
+        if (!file.is_open())
+            return std::nullopt;
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        uint64_t length;
+        uint64_t hash;
+        if (contents.size() < sizeof(length) + sizeof(hash))
+            return std::nullopt;
+        size_t body = contents.size() - sizeof(hash);
+        memcpy(&hash, contents.data() + body, sizeof(hash));
+        if (hash != fnv1a(contents.data(), body))
+            return std::nullopt;
+        memcpy(&length, contents.data(), sizeof(length));
+        if (length > body - sizeof(length) || contents.compare(sizeof(length), length, key) != 0)
+            return std::nullopt;
+        size_t start = sizeof(length) + length;
+        return contents.substr(start, body - start);
+    }
+
+    void ResultCache::save(const std::string &key, const char *kind, const std::string &payload) const
+    {
+        std::string contents;
+        put_value(contents, (uint64_t)key.size());
+        contents += key;
+        contents += payload;
+        put_value(contents, fnv1a(contents.data(), contents.size()));
+
+        std::string path = this->path_for(key, kind);
+        std::string temporary = path + ".XXXXXX";
+        int fd = mkstemp(&temporary[0]);
+        if (fd < 0)
+            throw CacheException("Could not write to the cache directory " + this->directory);
+        size_t written = 0;
+        while (written < contents.size())
+        {
+            ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                break;
+            written += (size_t)n;
+        }
+        close(fd);
+        if (written < contents.size() || rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            unlink(temporary.c_str());
+            throw CacheException("Could not write " + path + ", the disk may be full");
+        }
+    }
+
+    std::optional<CachedVerdict> ResultCache::find_verdict(const Program &prog, const std::string &label,
+                                                           const ReachOptions &options) const
+    {
+        auto m_payload = this->load(verdict_key(prog, label, options), "verdict");
+        if (!m_payload.has_value())
+            return std::nullopt;
+
+        PayloadReader reader(m_payload.value());
+        uint8_t has_run, abstract_input, bounded;
+        if (!reader.get(has_run) || !reader.get(abstract_input) || !reader.get(bounded))
+            return std::nullopt;
+        CachedVerdict verdict{std::nullopt, abstract_input != 0, bounded != 0};
+        if (has_run)
+        {
+            ReachRun run;
+            if (!get_states(reader, run.prefix) || !get_states(reader, run.cycle))
+                return std::nullopt;
+            verdict.run = run;
+        }
+        if (!reader.done())
+            return std::nullopt;
+        return verdict;
+    }
+
+    void ResultCache::store_verdict(const Program &prog, const std::string &label, const ReachOptions &options,
+                                    const CachedVerdict &verdict) const
+    {
+        std::string payload;
+        put_value(payload, (uint8_t)verdict.run.has_value());
+        put_value(payload, (uint8_t)verdict.abstract_input);
+        put_value(payload, (uint8_t)verdict.bounded);
+        if (verdict.run.has_value())
+        {
+            put_states(payload, verdict.run.value().prefix);
+            put_states(payload, verdict.run.value().cycle);
+        }
+        this->save(verdict_key(prog, label, options), "verdict", payload);
+    }
+
+    std::optional<StateSpace> ResultCache::find_space(const Program &prog, bool abstract_input,
+                                                      const ReachOptions &options) const
+    {
+        auto m_payload = this->load(space_key(prog, abstract_input, options), "space");
+        if (!m_payload.has_value())
+            return std::nullopt;
+
+        PayloadReader reader(m_payload.value());
+        StateSpace space;
+        space.abstract_input = abstract_input;
+        space.max_depth = options.max_depth;
+        uint8_t complete;
+        uint64_t depth;
+        uint32_t count;
+        if (!reader.get(complete) || !reader.get(depth) || !reader.get(count))
+            return std::nullopt;
+        space.complete = complete != 0;
+        space.depth = depth;
+        space.pcs.resize(count);
+        space.successors.resize(count);
+        for (uint32_t node = 0; node < count; node++)
+        {
+            uint64_t pc;
+            uint32_t successors;
+            if (!reader.get(pc) || !reader.get(successors))
+                return std::nullopt;
+            space.pcs[node] = pc;
+            for (uint32_t i = 0; i < successors; i++)
+            {
+                uint32_t next;
+                if (!reader.get(next) || next >= count)
+                    return std::nullopt;
+                space.successors[node].push_back(next);
+            }
+        }
+        if (count == 0 || !reader.done())
+            return std::nullopt;
+        return space;
+    }
+
+    void ResultCache::store_space(const Program &prog, const ReachOptions &options, const StateSpace &space) const
+    {
+        std::string payload;
+        put_value(payload, (uint8_t)space.complete);
+        put_value(payload, (uint64_t)space.depth);
+        put_value(payload, (uint32_t)space.successors.size());
+        for (size_t node = 0; node < space.successors.size(); node++)
+        {
+            put_value(payload, (uint64_t)space.pcs[node]);
+            put_value(payload, (uint32_t)space.successors[node].size());
+            for (uint32_t next : space.successors[node])
+                put_value(payload, next);
+        }
+        this->save(space_key(prog, space.abstract_input, options), "space", payload);
+    }
+}
\ No newline at end of file
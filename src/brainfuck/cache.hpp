@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <exception>
+#include "program.hpp"
+#include "analysis.hpp"
+#include "bfs.hpp"
+
+namespace brainfuck
+{
+    class CacheException : public std::exception
+    {
+    private:
+        using std::exception::what;
+        std::string message;
+
+    public:
+        CacheException(std::string msg) : message(msg) {}
+        const char *what()
+        {
+            return message.c_str();
+        }
+    };
+
+    // A verdict of check_reach as the cache keeps it
+    struct CachedVerdict
+    {
+        std::optional<ReachRun> run;
+        bool abstract_input; // of the Kripke structure the run is on
+        bool bounded;
+    };
+
+    // Verdicts and state spaces of earlier checks, in files of a directory
+    // that outlive the process. Entries are found by a hash of the program's
+    // instructions, its labels, its IOModel and the options that change the
+    // answer, and hold all of that to tell collisions apart. Files that
+    // can't be read or don't match count as missing. New files are renamed
+    // into place, so processes can share a directory.
+    class ResultCache
+    {
+    private:
+        std::string directory;
+
+        std::string path_for(const std::string &key, const char *kind) const;
+        std::optional<std::string> load(const std::string &key, const char *kind) const;
+        void save(const std::string &key, const char *kind, const std::string &payload) const;
+
+    public:
+        // Creates the directory if it isn't there. Throws CacheException if
+        // that fails.
+        ResultCache(std::string directory);
+        std::optional<CachedVerdict> find_verdict(const Program &prog, const std::string &label,
+                                                  const ReachOptions &options) const;
+        // Throws CacheException if the verdict can't be written
+        void store_verdict(const Program &prog, const std::string &label, const ReachOptions &options,
+                           const CachedVerdict &verdict) const;
+        // The space of bfs_explore, for any label
+        std::optional<StateSpace> find_space(const Program &prog, bool abstract_input,
+                                             const ReachOptions &options) const;
+        // Throws CacheException if the space can't be written
+        void store_space(const Program &prog, const ReachOptions &options, const StateSpace &space) const;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include <array>
+#include <vector>
+#include <optional>
+#include <unordered_set>
+#include <stdlib.h>
+#include "classes.hpp"
+
+namespace brainfuck
+{
+    // Paths that wander further from the read cell, or take more steps than
+    // this, make the analysis give up for that ,
+    static const long MAX_OFFSET = 1024;
+    static const size_t MAX_VISITS = 1 << 16;
+
+    // Where the analysis is: the pc, the pointer relative to the read cell
+    // and what has been added to the read value so far
+    struct Position
+    {
+        instr_ptr_t pc;
+        long offset;
+        uint8_t delta;
+    };
+
+    static uint64_t position_key(const Position &pos)
+    {
+        return (uint64_t)pos.pc << 20 | (uint64_t)(pos.offset + MAX_OFFSET) << 8 | pos.delta;
+    }
+
+    // Bytes a zero test on the read cell can single out after the , at
+    // read_pc, or nothing if they can't be worked out
+    static std::optional<std::array<bool, 256>> tested_bytes(
+        const std::vector<Instruction> &instrs,
+        const std::vector<instr_ptr_t> &jumps,
+        instr_ptr_t read_pc,
+        bool reads_can_keep)
+    {
+        std::array<bool, 256> tested{};
+        std::unordered_set<uint64_t> visited;
+        std::vector<Position> work{Position{read_pc + 1, 0, 0}};
+        while (!work.empty())
+        {
+            Position pos = work.back();
+            work.pop_back();
+            if (pos.pc >= instrs.size())
+                continue;
+            if (pos.offset < -MAX_OFFSET || pos.offset > MAX_OFFSET || visited.size() >= MAX_VISITS)
+                return std::nullopt;
+            if (!visited.insert(position_key(pos)).second)
+                continue;
+
+            bool on_read = pos.offset == 0;
+            Position next{pos.pc + 1, pos.offset, pos.delta};
+            switch (instrs[pos.pc])
+            {
+            case Instruction::left:
+                next.offset--;
+                break;
+
+            case Instruction::right:
+                next.offset++;
+                break;
+
+            case Instruction::inc:
+                if (on_read)
+                    next.delta++;
+                break;
+
+            case Instruction::dec:
+                if (on_read)
+                    next.delta--;
+                break;
+
+            case Instruction::put:
+                break;
+
+            case Instruction::get:
+                // Read over, nothing after this can see the value, unless
+                // a read at EOF leaves the cell alone
+                if (on_read && !reads_can_keep)
+                    continue;
+                break;
+
+            case Instruction::fwd:
+            case Instruction::bwd:
+            {
+                bool is_fwd = instrs[pos.pc] == Instruction::fwd;
+                instr_ptr_t if_zero = is_fwd ? jumps[pos.pc] : pos.pc + 1;
+                instr_ptr_t if_nonzero = is_fwd ? pos.pc + 1 : jumps[pos.pc];
+                // The read cell is zero for exactly one byte. Once it is
+                // known to be that byte there is nothing left to tell apart,
+                // so only the other branch goes on.
+                if (on_read)
+                    tested[(uint8_t)(0 - pos.delta)] = true;
+                else
+                    work.push_back(Position{if_zero, pos.offset, pos.delta});
+                next.pc = if_nonzero;
+                break;
+            }
+
+            default:
+                abort();
+            }
+            work.push_back(next);
+        }
+        return tested;
+    }
+
+    InputClasses::InputClasses(const Program &prog)
+    {
+        const std::vector<Instruction> &instrs = prog.get_instructions();
+        std::vector<instr_ptr_t> jumps(instrs.size(), 0);
+        for (const auto &kv : prog.get_jmp_map())
+            jumps[kv.first] = kv.second;
+
+        bool reads_can_keep = prog.io_model.get_no_change_on_eof();
+        this->representatives.resize(instrs.size());
+        for (instr_ptr_t pc = 0; pc < instrs.size(); pc++)
+        {
+            if (instrs[pc] != Instruction::get)
+                continue;
+            std::vector<uint8_t> &reps = this->representatives[pc];
+            auto tested = tested_bytes(instrs, jumps, pc, reads_can_keep);
+            // Every tested byte is a class of its own, and all the others
+            // share one
+            bool others = false;
+            for (unsigned int b = 0; b < 256; b++)
+            {
+                if (!tested.has_value() || tested.value()[b])
+                {
+                    reps.push_back((uint8_t)b);
+                }
+                else if (!others)
+                {
+                    reps.push_back((uint8_t)b);
+                    others = true;
+                }
+            }
+        }
+    }
+
+    const std::vector<uint8_t> &InputClasses::get_representatives(instr_ptr_t pc) const
+    {
+        return this->representatives[pc];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include "program.hpp"
+
+namespace brainfuck
+{
+    // Partition of the bytes every , can read into classes that the rest of
+    // the program can't tell apart. The read cell is followed statically
+    // through every path until it is read over; only a [ or ] on it can see
+    // its value, and only whether it equals one particular byte. Bytes that
+    // no such test singles out behave the same, so one of them is enough.
+    class InputClasses
+    {
+    private:
+        // Smallest byte of every class for each pc, empty for pcs that are
+        // not a ,
+        std::vector<std::vector<uint8_t>> representatives;
+
+    public:
+        InputClasses(const Program &prog);
+        // In increasing order. Every byte when the analysis gave up.
+        const std::vector<uint8_t> &get_representatives(instr_ptr_t pc) const;
+    };
+}
\ No newline at end of file
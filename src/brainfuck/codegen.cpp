@@ -0,0 +1,265 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include <errno.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "codegen.hpp"
+#include "bytecode.hpp"
+
+extern char **environ;
+
+namespace brainfuck
+{
+    static const char *C_RUNTIME = R"(#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static unsigned char input[1 << 16];
+static size_t input_pos, input_end;
+static unsigned char output[1 << 16];
+static size_t output_used;
+
+static void flush_output(void)
+{
+    size_t done = 0;
+    while (done < output_used)
+    {
+        ssize_t n = write(1, output + done, output_used - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            break;
+        done += (size_t)n;
+    }
+    output_used = 0;
+}
+
+static inline void put_char(unsigned char c)
+{
+    if (output_used == sizeof(output))
+        flush_output();
+    output[output_used++] = c;
+}
+
+static inline int get_char(void)
+{
+    if (input_pos == input_end)
+    {
+        ssize_t n;
+        flush_output();
+        do
+            n = read(0, input, sizeof(input));
+        while (n < 0 && errno == EINTR);
+        if (n <= 0)
+            return -1;
+        input_pos = 0;
+        input_end = (size_t)n;
+    }
+    return input[input_pos++];
+}
+)";
+
+    // Finds the next zero cell to the right with memchr, wrapping around
+    // once. Like the loop it replaces, it never returns if there is none.
+    static const char *C_SCAN_RIGHT = R"(
+static size_t scan_right(const cell_t *tape, size_t ptr)
+{
+    const cell_t *hit = memchr(tape + ptr, 0, MEMORY_SIZE - ptr);
+    if (hit == NULL)
+        hit = memchr(tape, 0, ptr);
+    if (hit == NULL)
+        for (;;)
+            ;
+    return (size_t)(hit - tape);
+}
+)";
+
+    static const char *cell_type(CellSize cell_size)
+    {
+        switch (cell_size)
+        {
+        case CellSize::EightBit:
+            return "uint8_t";
+
+        case CellSize::SixteenBit:
+            return "uint16_t";
+
+        case CellSize::ThirtyTwoBit:
+            return "uint32_t";
+
+        default:
+            abort();
+        }
+    }
+
+    std::string generate_c(const Program &prog)
+    {
+        const MemoryModel &memory_model = prog.memory_model;
+        const IOModel &io_model = prog.io_model;
+        Bytecode code = Bytecode::compile(prog);
+        const std::vector<ByteOp> &ops = code.get_ops();
+        bool wrapping = memory_model.is_wrapping();
+        bool byte_cells = memory_model.get_cell_size() == CellSize::EightBit;
+        unsigned long mask = memory_model.get_max_value();
+        bool uses_scan_right = false;
+        for (const ByteOp &op : ops)
+        {
+            if (op.code == OpCode::op_scan && op.arg == 1)
+                uses_scan_right = byte_cells;
+        }
+
+        std::ostringstream c;
+        c << C_RUNTIME << "\n";
+        c << "typedef " << cell_type(memory_model.get_cell_size()) << " cell_t;\n";
+        c << "#define MEMORY_SIZE ((size_t)" << memory_model.get_memory_size() << "u)\n";
+        if (uses_scan_right)
+            c << C_SCAN_RIGHT;
+        c << "\nint main(void)\n{\n";
+        c << "    cell_t *tape = calloc(MEMORY_SIZE, sizeof(cell_t));\n";
+        c << "    size_t ptr = 0;\n";
+        c << "    int in;\n";
+        c << "    if (tape == NULL)\n        return 1;\n";
+        c << "    (void)in;\n";
+
+        std::string indent = "    ";
+        for (const ByteOp &op : ops)
+        {
+            // Cell arguments are reduced modulo the cell size, so negative
+            // amounts become their unsigned equivalent
+            unsigned long cell_arg = (unsigned long)op.arg & mask;
+            unsigned long step = op.arg < 0 ? (unsigned long)-op.arg : (unsigned long)op.arg;
+
+            switch (op.code)
+            {
+            case OpCode::op_add:
+                c << indent << "tape[ptr] += " << cell_arg << "u;\n";
+                break;
+
+            case OpCode::op_move:
+                if (wrapping)
+                    c << indent << "ptr += " << step << "u;\n"
+                      << indent << "if (ptr >= MEMORY_SIZE)\n"
+                      << indent << "    ptr -= MEMORY_SIZE;\n";
+                else if (op.arg < 0)
+                    c << indent << "ptr = ptr > " << step << "u ? ptr - " << step << "u : 0;\n";
+                else
+                    c << indent << "ptr = MEMORY_SIZE - 1 - ptr > " << step << "u ? ptr + " << step
+                      << "u : MEMORY_SIZE - 1;\n";
+                break;
+
+            case OpCode::op_set:
+                c << indent << "tape[ptr] = " << cell_arg << "u;\n";
+                break;
+
+            case OpCode::op_mul:
+                c << indent << "tape[ptr + " << op.offset << "u >= MEMORY_SIZE ? ptr + " << op.offset
+                  << "u - MEMORY_SIZE : ptr + " << op.offset << "u] += (cell_t)(tape[ptr] * " << cell_arg << "u);\n";
+                break;
+
+            case OpCode::op_scan:
+                if (uses_scan_right && op.arg == 1)
+                    c << indent << "ptr = scan_right(tape, ptr);\n";
+                else if (op.arg > 0)
+                    c << indent << "while (tape[ptr] != 0)\n"
+                      << indent << "    ptr = ptr + " << step << "u >= MEMORY_SIZE ? ptr + " << step
+                      << "u - MEMORY_SIZE : ptr + " << step << "u;\n";
+                else
+                    c << indent << "while (tape[ptr] != 0)\n"
+                      << indent << "    ptr = ptr >= " << step << "u ? ptr - " << step
+                      << "u : ptr + MEMORY_SIZE - " << step << "u;\n";
+                break;
+
+            case OpCode::op_get:
+                c << indent << "in = get_char();\n";
+                if (io_model.get_no_change_on_eof())
+                    c << indent << "if (in >= 0)\n"
+                      << indent << "    tape[ptr] = (cell_t)in;\n";
+                else
+                    c << indent << "tape[ptr] = in >= 0 ? (cell_t)in : "
+                      << (unsigned int)io_model.get_eof_char() << "u;\n";
+                break;
+
+            case OpCode::op_put:
+                c << indent << "put_char((unsigned char)tape[ptr]);\n";
+                break;
+
+            case OpCode::op_jz:
+                // Loops in the bytecode are properly nested, so every jz/jnz
+                // pair becomes a while loop
+                c << indent << "while (tape[ptr] != 0)\n"
+                  << indent << "{\n";
+                indent += "    ";
+                break;
+
+            case OpCode::op_jnz:
+                indent.resize(indent.size() - 4);
+                c << indent << "}\n";
+                break;
+
+            case OpCode::op_halt:
+                c << indent << "flush_output();\n"
+                  << indent << "free(tape);\n"
+                  << indent << "return 0;\n";
+                break;
+
+            default:
+                abort();
+            }
+        }
+        c << "}\n";
+        return c.str();
+    }
+
+    void compile_native(const Program &prog, const std::string &output, const std::string &compiler)
+    {
+        std::string source = generate_c(prog);
+
+        const char *tmpdir = getenv("TMPDIR");
+        std::string path = std::string(tmpdir != nullptr ? tmpdir : "/tmp") + "/braincheckXXXXXX.c";
+        int fd = mkstemps(&path[0], 2);
+        if (fd < 0)
+            throw CompileException("Could not create a temporary file for the generated code");
+        size_t written = 0;
+        while (written < source.size())
+        {
+            ssize_t n = write(fd, source.data() + written, source.size() - written);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                break;
+            written += (size_t)n;
+        }
+        close(fd);
+        if (written < source.size())
+        {
+            unlink(path.c_str());
+            throw CompileException("Could not write the generated code to " + path);
+        }
+
+        std::vector<std::string> args{compiler, "-O2", "-o", output, path};
+        std::vector<char *> argv;
+        for (std::string &arg : args)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+
+        pid_t pid;
+        int status = 0;
+        int error = posix_spawnp(&pid, compiler.c_str(), nullptr, nullptr, argv.data(), environ);
+        if (error == 0)
+        {
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+                ;
+        }
+        unlink(path.c_str());
+
+        if (error != 0)
+            throw CompileException("Could not run " + compiler);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            throw CompileException(compiler + " failed to build " + output);
+    }
+}
\ No newline at end of file
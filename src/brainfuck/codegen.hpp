@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include "program.hpp"
+
+namespace brainfuck
+{
+    // Lowers the program's bytecode to a standalone C program. Cell size,
+    // memory size, wrapping and the end-of-file behaviour are baked into the
+    // generated code.
+    std::string generate_c(const Program &prog);
+
+    // Builds a native executable at output by running compiler on the
+    // generated C code
+    void compile_native(const Program &prog, const std::string &output, const std::string &compiler);
+
+    class CompileException : public std::exception
+    {
+    private:
+        using std::exception::what;
+        std::string message;
+
+    public:
+        CompileException(std::string msg) : message(msg) {}
+        const char *what()
+        {
+            return message.c_str();
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include <sstream>
+#include <algorithm>
+#include "cube.hpp"
+
+namespace brainfuck
+{
+    KCubeIterator::KCubeIterator(const spot::cubeset *cubeset)
+    {
+        this->pos = 0;
+        this->cubeset = cubeset;
+        this->cond = cubeset->alloc();
+    }
+
+    KCubeIterator::~KCubeIterator()
+    {
+        this->cubeset->release(this->cond);
+    }
+
+    void KCubeIterator::recycle(const std::vector<shared_state_id_t> &states, size_t label, size_t aps)
+    {
+        this->pos = 0;
+        this->states = states;
+        for (size_t i = 0; i < aps; i++)
+        {
+            if (i == label)
+                this->cubeset->set_true_var(this->cond, i);
+            else
+                this->cubeset->set_false_var(this->cond, i);
+        }
+    }
+
+    void KCubeIterator::next()
+    {
+        this->pos++;
+    }
+
+    bool KCubeIterator::done() const
+    {
+        return this->pos >= this->states.size();
+    }
+
+    shared_state_id_t KCubeIterator::state() const
+    {
+        return this->states[this->pos];
+    }
+
+    spot::cube KCubeIterator::condition() const
+    {
+        return this->cond;
+    }
+
+    unsigned KCubeIterator::fireable() const
+    {
+        return this->states.size() - this->pos;
+    }
+
+    size_t KCubeStateHash::operator()(shared_state_id_t state) const
+    {
+        return (size_t)(state * 0x9e3779b97f4a7c15ULL);
+    }
+
+    bool KCubeStateEqual::operator()(shared_state_id_t left, shared_state_id_t right) const
+    {
+        return left == right;
+    }
+
+    void shared_successors(const KProgram &prog, SharedStateStore &store, KCubeThread &thread,
+                           shared_state_id_t state)
+    {
+        thread.shared.clear();
+        successors(prog, store, state, thread.shared, nullptr);
+    }
+}
+
+namespace spot
+{
+    using namespace brainfuck;
+
+    kripkecube<shared_state_id_t, KCubeIterator>::kripkecube(const Program &prog, const std::vector<std::string> &aps,
+                                                             bool abstract_input, unsigned int threads)
+        : cubeset(aps.size()), store(KRIPKE_MEMORY_SIZE)
+    {
+        this->prog = std::make_shared<const KProgram>(prog, abstract_input);
+        this->aps = aps;
+        // Labels that aren't aps of the property are false everywhere
+        this->labels.assign(this->prog->ops.size() + 1, aps.size());
+        for (const auto &kv : prog.get_label_map())
+        {
+            for (size_t i = 0; i < aps.size(); i++)
+            {
+                if (aps[i] == kv.second)
+                    this->labels[kv.first] = i;
+            }
+        }
+        this->threads.resize(threads);
+    }
+
+    kripkecube<shared_state_id_t, KCubeIterator>::~kripkecube()
+    {
+        for (KCubeThread &thread : this->threads)
+        {
+            for (KCubeIterator *it : thread.recycled)
+                delete it;
+        }
+    }
+
+    shared_state_id_t kripkecube<shared_state_id_t, KCubeIterator>::initial(unsigned tid)
+    {
+        PackedState state;
+        state.header = StateHeader{0, 0, std::nullopt};
+        if (this->prog->chars_until_eof.has_value())
+            state.header.remaining_stdin_chars = (unsigned int)this->prog->chars_until_eof.value();
+        (void)tid;
+        return this->store.unpack(state);
+    }
+
+    unsigned kripkecube<shared_state_id_t, KCubeIterator>::get_threads()
+    {
+        return this->threads.size();
+    }
+
+    std::string kripkecube<shared_state_id_t, KCubeIterator>::to_string(const shared_state_id_t state,
+                                                                        unsigned tid) const
+    {
+        const StateHeader &header = this->store.get_header(state);
+        std::ostringstream out;
+        out << "pc = "
+            << header.pc
+            << "; mp = "
+            << header.mem_ptr;
+        (void)tid;
+        return out.str();
+    }
+
+    KCubeIterator *kripkecube<shared_state_id_t, KCubeIterator>::succ(const shared_state_id_t state, unsigned tid)
+    {
+        KCubeThread &thread = this->threads[tid];
+        shared_successors(*this->prog, this->store, thread, state);
+
+        KCubeIterator *it;
+        if (!thread.recycled.empty())
+        {
+            it = thread.recycled.back();
+            thread.recycled.pop_back();
+        }
+        else
+        {
+            it = new KCubeIterator(&this->cubeset);
+        }
+        instr_ptr_t pc = std::min<instr_ptr_t>(this->store.get_header(state).pc, this->prog->ops.size());
+        it->recycle(thread.shared, this->labels[pc], this->aps.size());
+        return it;
+    }
+
+    void kripkecube<shared_state_id_t, KCubeIterator>::recycle(KCubeIterator *it, unsigned tid)
+    {
+        this->threads[tid].recycled.push_back(it);
+    }
+
+    const std::vector<std::string> kripkecube<shared_state_id_t, KCubeIterator>::ap()
+    {
+        return this->aps;
+    }
+
+    size_t kripkecube<shared_state_id_t, KCubeIterator>::state_count() const
+    {
+        return this->store.state_count();
+    }
+}
\ No newline at end of file
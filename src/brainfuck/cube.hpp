@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <spot/kripke/kripke.hh>
+#include <spot/twacube/cube.hh>
+#include "program.hpp"
+#include "store.hpp"
+#include "kripke.hpp"
+
+namespace brainfuck
+{
+    // Successors of a state of the cube, all sharing the condition of that
+    // state. Owns its cube and is handed back to the cube for reuse.
+    class KCubeIterator
+    {
+    private:
+        std::vector<shared_state_id_t> states;
+        unsigned long pos;
+        const spot::cubeset *cubeset;
+        spot::cube cond;
+
+    public:
+        KCubeIterator(const spot::cubeset *cubeset);
+        ~KCubeIterator();
+        KCubeIterator(const KCubeIterator &) = delete;
+        KCubeIterator &operator=(const KCubeIterator &) = delete;
+        // Starts over with new successors, labeled with the ap at index
+        // label or with none if it is out of range
+        void recycle(const std::vector<shared_state_id_t> &states, size_t label, size_t aps);
+        void next();
+        bool done() const;
+        shared_state_id_t state() const;
+        spot::cube condition() const;
+        unsigned fireable() const;
+    };
+
+    // What each thread of the cube keeps for itself: the successors it
+    // found last and iterators it can reuse
+    struct KCubeThread
+    {
+        std::vector<shared_state_id_t> shared;
+        std::vector<KCubeIterator *> recycled;
+    };
+
+    // Successors of a state of a shared store into thread.shared. The
+    // program runs right in the shared store, so the tapes of the states
+    // share their pages and pairs across threads as in a StateStore.
+    void shared_successors(const KProgram &prog, SharedStateStore &store, KCubeThread &thread,
+                           shared_state_id_t state);
+
+    struct KCubeStateHash
+    {
+        size_t operator()(shared_state_id_t state) const;
+    };
+
+    struct KCubeStateEqual
+    {
+        bool operator()(shared_state_id_t left, shared_state_id_t right) const;
+    };
+}
+
+namespace spot
+{
+    // The Kripke structure in the form Spot's multi-core emptiness checks
+    // take it. Every thread expands states in one shared store, whose ids
+    // are the states, so every thread sees the same state space as the
+    // sequential Kripke structure.
+    template <>
+    class kripkecube<brainfuck::shared_state_id_t, brainfuck::KCubeIterator> final
+        : public std::enable_shared_from_this<kripkecube<brainfuck::shared_state_id_t, brainfuck::KCubeIterator>>
+    {
+    private:
+        std::shared_ptr<const brainfuck::KProgram> prog;
+        std::vector<std::string> aps;
+        std::vector<size_t> labels; // index into aps of the label at every pc
+        spot::cubeset cubeset;
+        brainfuck::SharedStateStore store;
+        std::vector<brainfuck::KCubeThread> threads;
+
+    public:
+        kripkecube(const brainfuck::Program &prog, const std::vector<std::string> &aps,
+                   bool abstract_input, unsigned int threads);
+        ~kripkecube();
+        brainfuck::shared_state_id_t initial(unsigned tid);
+        unsigned get_threads();
+        std::string to_string(const brainfuck::shared_state_id_t state, unsigned tid) const;
+        brainfuck::KCubeIterator *succ(const brainfuck::shared_state_id_t state, unsigned tid);
+        void recycle(brainfuck::KCubeIterator *it, unsigned tid);
+        const std::vector<std::string> ap();
+        size_t state_count() const;
+    };
+}
+
+namespace brainfuck
+{
+    typedef spot::kripkecube<shared_state_id_t, KCubeIterator> KripkeCube;
+    typedef std::shared_ptr<KripkeCube> kripkecube_ptr;
+}
\ No newline at end of file
@@ -0,0 +1,698 @@
+#include <queue>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "external.hpp"
+#include "kripke.hpp"
+#include "pool.hpp"
+#include "lasso.hpp"
+
+namespace brainfuck
+{
+    // States read from the frontier and expanded in one go
+    static const size_t EXTERNAL_CHUNK = 4096;
+    // Bytes a file reads or writes at a time
+    static const size_t SPILL_BUFFER = 1 << 16;
+    // Smallest store a thread starts over from
+    static const size_t MIN_THREAD_STORE = 1 << 20;
+    static const uint32_t NO_STATE = std::numeric_limits<uint32_t>::max();
+
+    // A file under TMPDIR that is removed right away, so it is gone as soon
+    // as it is closed, however the search ends
+    static int make_spill_file()
+    {
+        const char *tmpdir = getenv("TMPDIR");
+        std::string path = std::string(tmpdir != nullptr ? tmpdir : "/tmp") + "/braincheckXXXXXX";
+        int fd = mkstemp(&path[0]);
+        if (fd < 0)
+            throw ExternalException("Could not create a temporary file in " + path.substr(0, path.rfind('/')));
+        unlink(path.c_str());
+        return fd;
+    }
+
+    // File that is written at its end and read anywhere
+    class SpillFile
+    {
+    private:
+        int fd;
+        uint64_t size; // flushed or not
+        std::vector<uint8_t> buffer;
+
+    public:
+        SpillFile();
+        ~SpillFile();
+        SpillFile(const SpillFile &) = delete;
+        SpillFile &operator=(const SpillFile &) = delete;
+        void append(const void *data, size_t length);
+        void flush();
+        // Only sees what has been flushed
+        void read(uint64_t offset, void *data, size_t length) const;
+        uint64_t get_size() const;
+    };
+
+    SpillFile::SpillFile()
+    {
+        this->fd = make_spill_file();
+        this->size = 0;
+    }
+
+    SpillFile::~SpillFile()
+    {
+        close(this->fd);
+    }
+
+    void SpillFile::append(const void *data, size_t length)
+    {
+        const uint8_t *bytes = (const uint8_t *)data;
+        this->buffer.insert(this->buffer.end(), bytes, bytes + length);
+        this->size += length;
+        if (this->buffer.size() >= SPILL_BUFFER)
+            this->flush();
+    }
+
+    void SpillFile::flush()
+    {
+        size_t written = 0;
+        while (written < this->buffer.size())
+        {
+            ssize_t n = write(this->fd, this->buffer.data() + written, this->buffer.size() - written);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                throw ExternalException("Could not write a temporary file, the disk may be full");
+            written += (size_t)n;
+        }
+        this->buffer.clear();
+    }
+
+    void SpillFile::read(uint64_t offset, void *data, size_t length) const
+    {
+        uint8_t *bytes = (uint8_t *)data;
+        while (length > 0)
+        {
+            ssize_t n = pread(this->fd, bytes, length, (off_t)offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw ExternalException("Could not read back a temporary file");
+            bytes += n;
+            offset += (uint64_t)n;
+            length -= (size_t)n;
+        }
+    }
+
+    uint64_t SpillFile::get_size() const
+    {
+        return this->size;
+    }
+
+    // Reads a file front to back, from some offset up to where it ended
+    // when the reader was made
+    class SpillReader
+    {
+    private:
+        const SpillFile *file;
+        uint64_t offset;
+        uint64_t end;
+        std::vector<uint8_t> buffer;
+        size_t pos;
+
+    public:
+        SpillReader(const SpillFile &file, uint64_t offset);
+        bool done() const;
+        void read(void *data, size_t length);
+    };
+
+    SpillReader::SpillReader(const SpillFile &file, uint64_t offset)
+    {
+        this->file = &file;
+        this->offset = offset;
+        this->end = file.get_size();
+        this->pos = 0;
+    }
+
+    bool SpillReader::done() const
+    {
+        return this->pos == this->buffer.size() && this->offset == this->end;
+    }
+
+    void SpillReader::read(void *data, size_t length)
+    {
+        uint8_t *bytes = (uint8_t *)data;
+        while (length > 0)
+        {
+            if (this->pos == this->buffer.size())
+            {
+                size_t chunk = (size_t)std::min<uint64_t>(SPILL_BUFFER, this->end - this->offset);
+                if (chunk == 0)
+                    throw ExternalException("A temporary file ended too early");
+                this->buffer.resize(chunk);
+                this->file->read(this->offset, this->buffer.data(), chunk);
+                this->offset += chunk;
+                this->pos = 0;
+            }
+            size_t n = std::min(length, this->buffer.size() - this->pos);
+            memcpy(bytes, this->buffer.data() + this->pos, n);
+            this->pos += n;
+            bytes += n;
+            length -= n;
+        }
+    }
+
+    // Array in a file of its own that the kernel pages in and out, zeroed
+    // at the start
+    template <typename T>
+    class MappedArray
+    {
+    private:
+        int fd;
+        size_t length;
+        T *data;
+
+    public:
+        MappedArray(size_t count);
+        ~MappedArray();
+        MappedArray(const MappedArray &) = delete;
+        MappedArray &operator=(const MappedArray &) = delete;
+        T &operator[](size_t i)
+        {
+            return this->data[i];
+        }
+    };
+
+    template <typename T>
+    MappedArray<T>::MappedArray(size_t count)
+    {
+        this->fd = make_spill_file();
+        this->length = std::max<size_t>(count, 1) * sizeof(T);
+        void *m = MAP_FAILED;
+        if (ftruncate(this->fd, (off_t)this->length) == 0)
+            m = mmap(nullptr, this->length, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+        if (m == MAP_FAILED)
+        {
+            close(this->fd);
+            throw ExternalException("Could not map a temporary file, the disk may be full");
+        }
+        this->data = (T *)m;
+    }
+
+    template <typename T>
+    MappedArray<T>::~MappedArray()
+    {
+        munmap(this->data, this->length);
+        close(this->fd);
+    }
+
+    static uint32_t get_u32(const uint8_t *&data)
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        return value;
+    }
+
+    // Any order works as long as it is total
+    static int compare_states(const std::vector<uint8_t> &left, const std::vector<uint8_t> &right)
+    {
+        if (left.size() != right.size())
+            return left.size() < right.size() ? -1 : 1;
+        return memcmp(left.data(), right.data(), left.size());
+    }
+
+    // Files hold states as their length, their bytes and a number: the id
+    // of the state in the set of seen states, or the state it was found
+    // from in a batch of successors
+    static void write_entry(SpillFile &file, const std::vector<uint8_t> &state, uint32_t tag)
+    {
+        uint32_t length = state.size();
+        file.append(&length, sizeof(length));
+        file.append(state.data(), state.size());
+        file.append(&tag, sizeof(tag));
+    }
+
+    static bool read_entry(SpillReader &reader, std::vector<uint8_t> &state, uint32_t &tag)
+    {
+        if (reader.done())
+            return false;
+        uint32_t length;
+        reader.read(&length, sizeof(length));
+        state.resize(length);
+        reader.read(state.data(), length);
+        reader.read(&tag, sizeof(tag));
+        return true;
+    }
+
+    // Bytes a batch holds for each state on top of the state itself
+    static const size_t BATCH_OVERHEAD = sizeof(std::vector<uint8_t>) + sizeof(uint32_t) + sizeof(size_t);
+
+    // Successors of a level that haven't been sorted yet
+    struct Batch
+    {
+        std::vector<std::vector<uint8_t>> states;
+        std::vector<uint32_t> parents;
+        size_t bytes = 0;
+    };
+
+    // Sorted by state and then parent, without repeats
+    static std::unique_ptr<SpillFile> write_batch(Batch &batch)
+    {
+        std::vector<size_t> order(batch.states.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t left, size_t right)
+                  {
+                      int c = compare_states(batch.states[left], batch.states[right]);
+                      return c != 0 ? c < 0 : batch.parents[left] < batch.parents[right]; });
+
+        auto file = std::make_unique<SpillFile>();
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            size_t entry = order[i];
+            if (i > 0 && batch.parents[entry] == batch.parents[order[i - 1]] &&
+                compare_states(batch.states[entry], batch.states[order[i - 1]]) == 0)
+                continue;
+            write_entry(*file, batch.states[entry], batch.parents[entry]);
+        }
+        file->flush();
+        batch = Batch();
+        return file;
+    }
+
+    struct ExternalThread
+    {
+        std::unique_ptr<StateStore> store;
+        std::vector<state_id_t> successors;
+        Batch found;
+        uint32_t looping = NO_STATE;
+    };
+
+    // Everything the search knows about the states it has seen, by id
+    struct ExternalGraph
+    {
+        SpillFile states;   // in the order of their ids
+        SpillFile offsets;  // of each state in states
+        SpillFile parents;  // the state each was first found from
+        SpillFile cut;      // whether each has the label and so isn't expanded
+        SpillFile edges;    // pairs of ids
+        uint32_t count = 0;
+        uint64_t edge_count = 0;
+    };
+
+    static uint32_t add_state(ExternalGraph &graph, const std::vector<uint8_t> &state, uint32_t parent,
+                              const std::vector<bool> &targets)
+    {
+        if (graph.count == NO_STATE)
+            throw ExternalException("Too many states for the external search");
+        uint64_t offset = graph.states.get_size();
+        uint32_t length = state.size();
+        graph.states.append(&length, sizeof(length));
+        graph.states.append(state.data(), state.size());
+        graph.offsets.append(&offset, sizeof(offset));
+        graph.parents.append(&parent, sizeof(parent));
+        const uint8_t *data = state.data();
+        size_t pc = get_u32(data);
+        uint8_t cut = targets[std::min(pc, targets.size() - 1)] ? 1 : 0;
+        graph.cut.append(&cut, sizeof(cut));
+        return graph.count++;
+    }
+
+    // Makes everything written so far readable
+    static void flush_graph(ExternalGraph &graph)
+    {
+        graph.states.flush();
+        graph.offsets.flush();
+        graph.parents.flush();
+        graph.cut.flush();
+        graph.edges.flush();
+    }
+
+    static PackedState load_state(const ExternalGraph &graph, uint32_t id)
+    {
+        uint64_t offset;
+        graph.offsets.read((uint64_t)id * sizeof(offset), &offset, sizeof(offset));
+        uint32_t length;
+        graph.states.read(offset, &length, sizeof(length));
+        std::vector<uint8_t> state(length);
+        graph.states.read(offset + sizeof(length), state.data(), length);
+        return decode_state(state.data());
+    }
+
+    // Delayed duplicate detection: the sorted batches of a level are merged
+    // with the sorted set of states seen so far. States not in it get the
+    // next ids, every successor becomes an edge, and the merged set replaces
+    // the old one.
+    static void merge_level(ExternalGraph &graph, std::unique_ptr<SpillFile> &seen,
+                            std::vector<std::unique_ptr<SpillFile>> &batches, const std::vector<bool> &targets)
+    {
+        struct Cursor
+        {
+            SpillReader reader;
+            std::vector<uint8_t> state;
+            uint32_t parent;
+        };
+        std::vector<Cursor> cursors;
+        for (const auto &batch : batches)
+            cursors.push_back(Cursor{SpillReader(*batch, 0), {}, 0});
+        auto later = [&](size_t left, size_t right)
+        {
+            int c = compare_states(cursors[left].state, cursors[right].state);
+            return c != 0 ? c > 0 : cursors[left].parent > cursors[right].parent;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+        for (size_t i = 0; i < cursors.size(); i++)
+        {
+            if (read_entry(cursors[i].reader, cursors[i].state, cursors[i].parent))
+                heap.push(i);
+        }
+
+        auto merged = std::make_unique<SpillFile>();
+        seen->flush();
+        SpillReader old(*seen, 0);
+        std::vector<uint8_t> old_state;
+        uint32_t old_id = 0;
+        bool has_old = read_entry(old, old_state, old_id);
+
+        std::vector<uint8_t> state;
+        std::vector<uint8_t> last;
+        uint32_t last_parent = NO_STATE;
+        uint32_t child = NO_STATE;
+        while (!heap.empty())
+        {
+            size_t top = heap.top();
+            heap.pop();
+            state.swap(cursors[top].state);
+            uint32_t parent = cursors[top].parent;
+            if (read_entry(cursors[top].reader, cursors[top].state, cursors[top].parent))
+                heap.push(top);
+
+            if (child != NO_STATE && compare_states(state, last) == 0)
+            {
+                if (parent == last_parent)
+                    continue;
+            }
+            else
+            {
+                while (has_old && compare_states(old_state, state) < 0)
+                {
+                    write_entry(*merged, old_state, old_id);
+                    has_old = read_entry(old, old_state, old_id);
+                }
+                if (has_old && compare_states(old_state, state) == 0)
+                {
+                    child = old_id;
+                }
+                else
+                {
+                    child = add_state(graph, state, parent, targets);
+                    write_entry(*merged, state, child);
+                }
+                last.swap(state);
+            }
+            last_parent = parent;
+            uint32_t edge[2] = {parent, child};
+            graph.edges.append(edge, sizeof(edge));
+            graph.edge_count++;
+        }
+        while (has_old)
+        {
+            write_entry(*merged, old_state, old_id);
+            has_old = read_entry(old, old_state, old_id);
+        }
+        merged->flush();
+        seen.swap(merged);
+        batches.clear();
+    }
+
+    static ReachRun make_run(const ExternalGraph &graph, const std::vector<uint32_t> &prefix,
+                             const std::vector<uint32_t> &cycle)
+    {
+        ReachRun run;
+        for (uint32_t id : prefix)
+            run.prefix.push_back(load_state(graph, id));
+        for (uint32_t id : cycle)
+            run.cycle.push_back(load_state(graph, id));
+        return run;
+    }
+
+    // The states before id along the ones each was first found from
+    static std::vector<uint32_t> path_to(const ExternalGraph &graph, uint32_t id)
+    {
+        std::vector<uint32_t> path;
+        uint32_t parent;
+        graph.parents.read((uint64_t)id * sizeof(parent), &parent, sizeof(parent));
+        while (parent != NO_STATE)
+        {
+            path.push_back(parent);
+            graph.parents.read((uint64_t)parent * sizeof(parent), &parent, sizeof(parent));
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    // The run along the states each was first found from, ending in a state
+    // that loops back to itself
+    static ReachRun make_looping_run(const ExternalGraph &graph, uint32_t id)
+    {
+        return make_run(graph, path_to(graph, id), std::vector<uint32_t>{id});
+    }
+
+    // Ids come in order of depth, and only states that weren't cut were
+    // expanded, so the depths along the first-found states are the fewest
+    // steps to each state that stay clear of the cut. The search for the
+    // cycle keeps all its arrays on disk as well.
+    static std::optional<ReachRun> find_short_lasso(ExternalGraph &graph, MappedArray<uint8_t> &left,
+                                                    MappedArray<uint64_t> &succ_start, MappedArray<uint32_t> &succs,
+                                                    size_t limit)
+    {
+        size_t count = graph.count;
+        MappedArray<uint32_t> depths(count);
+        SpillReader parents(graph.parents, 0);
+        for (size_t id = 0; id < count; id++)
+        {
+            uint32_t parent;
+            parents.read(&parent, sizeof(parent));
+            depths[id] = parent == NO_STATE ? 0 : depths[parent] + 1;
+        }
+
+        std::vector<uint32_t> best_cycle = find_cycle<MappedArray>(count, succ_start, succs, left, depths, limit);
+        if (best_cycle.empty())
+            return std::nullopt;
+        return make_run(graph, path_to(graph, best_cycle.front()), best_cycle);
+    }
+
+    // Some run into a cycle of states without the label, with every array
+    // the size of the state space mapped from disk. States that must reach
+    // the label are peeled off as in bfs_reach, after which every state
+    // left has a successor that is left as well, so following them from the
+    // initial state has to come back around. With a limit the run is the
+    // shortest of at most that many states instead, as in bfs_reach.
+    static std::optional<ReachRun> find_lasso(ExternalGraph &graph, size_t limit)
+    {
+        size_t count = graph.count;
+        flush_graph(graph);
+        MappedArray<uint8_t> left(count);
+        SpillReader cut(graph.cut, 0);
+        for (size_t id = 0; id < count; id++)
+        {
+            uint8_t is_cut;
+            cut.read(&is_cut, sizeof(is_cut));
+            left[id] = is_cut ? 0 : 1;
+        }
+
+        MappedArray<uint64_t> succ_start(count + 1);
+        MappedArray<uint64_t> pred_start(count + 1);
+        uint32_t edge[2];
+        for (SpillReader edges(graph.edges, 0); !edges.done();)
+        {
+            edges.read(edge, sizeof(edge));
+            if (!left[edge[1]])
+                continue;
+            succ_start[edge[0] + 1]++;
+            pred_start[edge[1] + 1]++;
+        }
+        for (size_t id = 0; id < count; id++)
+        {
+            succ_start[id + 1] += succ_start[id];
+            pred_start[id + 1] += pred_start[id];
+        }
+        MappedArray<uint32_t> succs(succ_start[count]);
+        MappedArray<uint32_t> preds(pred_start[count]);
+        MappedArray<uint32_t> out_degree(count);
+        MappedArray<uint32_t> in_filled(count);
+        for (SpillReader edges(graph.edges, 0); !edges.done();)
+        {
+            edges.read(edge, sizeof(edge));
+            if (!left[edge[1]])
+                continue;
+            succs[succ_start[edge[0]] + out_degree[edge[0]]++] = edge[1];
+            preds[pred_start[edge[1]] + in_filled[edge[1]]++] = edge[0];
+        }
+
+        MappedArray<uint32_t> work(count);
+        size_t top = 0;
+        for (size_t id = 0; id < count; id++)
+        {
+            if (left[id] && out_degree[id] == 0)
+                work[top++] = id;
+        }
+        while (top > 0)
+        {
+            uint32_t id = work[--top];
+            left[id] = 0;
+            for (uint64_t i = pred_start[id]; i < pred_start[id + 1]; i++)
+            {
+                if (--out_degree[preds[i]] == 0)
+                    work[top++] = preds[i];
+            }
+        }
+        if (!left[0])
+            return std::nullopt;
+        if (limit != std::numeric_limits<size_t>::max())
+            return find_short_lasso(graph, left, succ_start, succs, limit);
+
+        // Steps to the lowest id left, which is usually closest to the start
+        MappedArray<uint32_t> step_of(count); // step + 1 of the walk, 0 if not on it
+        std::vector<uint32_t> walk;
+        uint32_t id = 0;
+        while (step_of[id] == 0)
+        {
+            walk.push_back(id);
+            step_of[id] = walk.size();
+            uint32_t next = NO_STATE;
+            for (uint64_t i = succ_start[id]; i < succ_start[id + 1]; i++)
+            {
+                if (left[succs[i]] && succs[i] < next)
+                    next = succs[i];
+            }
+            id = next;
+        }
+        size_t start = step_of[id] - 1;
+        return make_run(graph, std::vector<uint32_t>(walk.begin(), walk.begin() + start),
+                        std::vector<uint32_t>(walk.begin() + start, walk.end()));
+    }
+
+    std::optional<ReachRun> external_reach(const Program &prog, const std::string &label, bool abstract_input,
+                                           const ReachOptions &options, bool *bounded)
+    {
+        KProgram kprog(prog, abstract_input);
+        std::vector<bool> targets(kprog.ops.size() + 1, false);
+        for (const auto &kv : prog.get_label_map())
+        {
+            if (kv.second == label)
+                targets[kv.first] = true;
+        }
+        if (bounded != nullptr)
+            *bounded = false;
+
+        WorkStealingPool pool(options.threads);
+        std::vector<ExternalThread> workers(pool.get_threads());
+        // Half the budget for successors waiting to be sorted, the rest for
+        // the states being expanded and the stores they run in
+        size_t batch_bytes = options.memory_budget / 2;
+        size_t chunk_bytes = options.memory_budget / 8;
+        size_t store_bytes = std::max(MIN_THREAD_STORE, options.memory_budget / (8 * workers.size()));
+
+        ExternalGraph graph;
+        auto seen = std::make_unique<SpillFile>();
+        PackedState initial;
+        initial.header = StateHeader{0, 0, std::nullopt};
+        if (kprog.chars_until_eof.has_value())
+            initial.header.remaining_stdin_chars = (unsigned int)kprog.chars_until_eof.value();
+        std::vector<uint8_t> root;
+        encode_state(initial, root);
+        write_entry(*seen, root, add_state(graph, root, NO_STATE, targets));
+
+        size_t max_depth = options.max_depth.has_value() ? options.max_depth.value() : std::numeric_limits<size_t>::max();
+        uint32_t level_start = 0;
+        uint64_t level_offset = 0;
+        for (size_t depth = 0; level_start < graph.count; depth++)
+        {
+            if (depth >= max_depth)
+            {
+                auto m_run = find_lasso(graph, max_depth);
+                if (bounded != nullptr && !m_run.has_value())
+                    *bounded = true;
+                return m_run;
+            }
+
+            uint32_t level_end = graph.count;
+            graph.states.flush();
+            SpillReader frontier(graph.states, level_offset);
+            level_offset = graph.states.get_size();
+            std::vector<std::unique_ptr<SpillFile>> batches;
+            Batch batch;
+            uint32_t next_id = level_start;
+            while (!frontier.done())
+            {
+                std::vector<std::vector<uint8_t>> chunk;
+                size_t read_bytes = 0;
+                while (!frontier.done() && chunk.size() < EXTERNAL_CHUNK && read_bytes < chunk_bytes)
+                {
+                    uint32_t length;
+                    frontier.read(&length, sizeof(length));
+                    chunk.emplace_back(length);
+                    frontier.read(chunk.back().data(), length);
+                    read_bytes += length;
+                }
+                uint32_t chunk_start = next_id;
+                next_id += chunk.size();
+
+                pool.run(chunk.size(), [&](size_t i, unsigned int worker)
+                         {
+                             ExternalThread &thread = workers[worker];
+                             PackedState state = decode_state(chunk[i].data());
+                             if (targets[std::min<size_t>(state.header.pc, kprog.ops.size())])
+                                 return;
+                             if (thread.store == nullptr || thread.store->memory_usage() > store_bytes)
+                                 thread.store = std::make_unique<StateStore>(KRIPKE_MEMORY_SIZE);
+                             state_id_t local = thread.store->unpack(state);
+                             thread.successors.clear();
+                             successors(kprog, *thread.store, local, thread.successors, nullptr);
+                             for (state_id_t successor : thread.successors)
+                             {
+                                 std::vector<uint8_t> bytes;
+                                 encode_state(thread.store->pack(successor), bytes);
+                                 if (bytes == chunk[i])
+                                     thread.looping = std::min(thread.looping, (uint32_t)(chunk_start + i));
+                                 thread.found.bytes += bytes.size() + BATCH_OVERHEAD;
+                                 thread.found.states.push_back(std::move(bytes));
+                                 thread.found.parents.push_back(chunk_start + i);
+                             } });
+
+                // Loops show up in order of the level, so the first one is
+                // as short as this search gets
+                uint32_t looping = NO_STATE;
+                for (ExternalThread &thread : workers)
+                {
+                    looping = std::min(looping, thread.looping);
+                    for (size_t i = 0; i < thread.found.states.size(); i++)
+                    {
+                        batch.states.push_back(std::move(thread.found.states[i]));
+                        batch.parents.push_back(thread.found.parents[i]);
+                    }
+                    batch.bytes += thread.found.bytes;
+                    thread.found = Batch();
+                }
+                if (looping != NO_STATE)
+                {
+                    flush_graph(graph);
+                    return make_looping_run(graph, looping);
+                }
+                if (batch.bytes >= batch_bytes)
+                    batches.push_back(write_batch(batch));
+            }
+            if (!batch.states.empty())
+                batches.push_back(write_batch(batch));
+
+            merge_level(graph, seen, batches, targets);
+            level_start = level_end;
+        }
+        return find_lasso(graph, std::numeric_limits<size_t>::max());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <exception>
+#include "program.hpp"
+#include "analysis.hpp"
+#include "bfs.hpp"
+
+namespace brainfuck
+{
+    class ExternalException : public std::exception
+    {
+    private:
+        using std::exception::what;
+        std::string message;
+
+    public:
+        ExternalException(std::string msg) : message(msg) {}
+        const char *what()
+        {
+            return message.c_str();
+        }
+    };
+
+    // Looks for a run that never reaches the label like bfs_reach, but keeps
+    // the states on disk, in files under TMPDIR that are gone once it
+    // returns. Successors of a level are sorted in memory in batches of up
+    // to options.memory_budget bytes, and only merged with the states seen
+    // before once the level is done, so memory does not grow with the state
+    // space. The run found is not always one of the shortest. Throws
+    // ExternalException if the files can't be written.
+    std::optional<ReachRun> external_reach(const Program &prog, const std::string &label, bool abstract_input,
+                                           const ReachOptions &options, bool *bounded = nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include <stdlib.h>
+#include "flow.hpp"
+#include "kripke.hpp"
+
+namespace brainfuck
+{
+    // The fixpoint is given up on after this many steps, and the walk stops
+    // after this many states
+    static const size_t MAX_FLOW_VISITS = 1 << 20;
+    static const size_t MAX_WALK_STATES = 1 << 12;
+    static const size_t NO_INDEX = std::numeric_limits<size_t>::max();
+
+    bool FlowState::operator==(const FlowState &other) const
+    {
+        return this->reached == other.reached && this->ptr == other.ptr && this->rest_zero == other.rest_zero &&
+               this->cells == other.cells;
+    }
+
+    static int cell_value(const FlowState &state, mem_ptr_t ptr)
+    {
+        auto it = state.cells.find(ptr);
+        if (it != state.cells.end())
+            return it->second;
+        return state.rest_zero ? 0 : FLOW_UNKNOWN;
+    }
+
+    // Only cells that differ from the rest are kept
+    static void set_cell(FlowState &state, mem_ptr_t ptr, int value)
+    {
+        if (value == (state.rest_zero ? 0 : FLOW_UNKNOWN))
+            state.cells.erase(ptr);
+        else
+            state.cells[ptr] = value;
+    }
+
+    static int current_value(const FlowState &state)
+    {
+        return state.ptr.has_value() ? cell_value(state, state.ptr.value()) : FLOW_UNKNOWN;
+    }
+
+    // Without a known pointer the write could go to any cell
+    static void write_current(FlowState &state, int value)
+    {
+        if (state.ptr.has_value())
+        {
+            set_cell(state, state.ptr.value(), value);
+            return;
+        }
+        state.cells.clear();
+        state.rest_zero = false;
+    }
+
+    // What holds on both paths
+    static FlowState join(const FlowState &left, const FlowState &right)
+    {
+        if (!left.reached)
+            return right;
+        if (!right.reached)
+            return left;
+        FlowState joined;
+        joined.reached = true;
+        if (left.ptr == right.ptr)
+            joined.ptr = left.ptr;
+        joined.rest_zero = left.rest_zero && right.rest_zero;
+        for (const FlowState *state : {&left, &right})
+        {
+            for (const auto &kv : state->cells)
+            {
+                int value = cell_value(left, kv.first);
+                set_cell(joined, kv.first, value == cell_value(right, kv.first) ? value : FLOW_UNKNOWN);
+            }
+        }
+        return joined;
+    }
+
+    // The pcs an instruction can go on to from a state, each with the state
+    // it gets there in. A [ or ] only goes the ways the cell allows, and
+    // the cell is zero after the way out of a loop.
+    static void flow_step(const std::vector<Instruction> &instrs, const std::vector<instr_ptr_t> &jumps,
+                          instr_ptr_t pc, const FlowState &state,
+                          std::vector<std::pair<instr_ptr_t, FlowState>> &out)
+    {
+        FlowState next = state;
+        int value = current_value(state);
+        switch (instrs[pc])
+        {
+        case Instruction::left:
+            if (next.ptr.has_value())
+                next.ptr = next.ptr.value() == 0 ? KRIPKE_MEMORY_SIZE - 1 : next.ptr.value() - 1;
+            break;
+
+        case Instruction::right:
+            if (next.ptr.has_value())
+                next.ptr = next.ptr.value() == KRIPKE_MEMORY_SIZE - 1 ? 0 : next.ptr.value() + 1;
+            break;
+
+        case Instruction::inc:
+            write_current(next, value == FLOW_UNKNOWN ? FLOW_UNKNOWN : (value + 1) & 0xff);
+            break;
+
+        case Instruction::dec:
+            write_current(next, value == FLOW_UNKNOWN ? FLOW_UNKNOWN : (value + 255) & 0xff);
+            break;
+
+        case Instruction::put:
+            break;
+
+        case Instruction::get:
+            write_current(next, FLOW_UNKNOWN);
+            break;
+
+        case Instruction::fwd:
+        case Instruction::bwd:
+        {
+            bool is_fwd = instrs[pc] == Instruction::fwd;
+            instr_ptr_t if_zero = is_fwd ? jumps[pc] : pc + 1;
+            instr_ptr_t if_nonzero = is_fwd ? pc + 1 : jumps[pc];
+            if (value == 0 || value == FLOW_UNKNOWN)
+            {
+                FlowState zero = state;
+                if (zero.ptr.has_value())
+                    set_cell(zero, zero.ptr.value(), 0);
+                out.push_back(std::make_pair(if_zero, zero));
+            }
+            if (value != 0)
+                out.push_back(std::make_pair(if_nonzero, state));
+            return;
+        }
+
+        default:
+            abort();
+        }
+        out.push_back(std::make_pair(pc + 1, next));
+    }
+
+    FlowAnalysis::FlowAnalysis(const Program &prog)
+    {
+        const std::vector<Instruction> &instrs = prog.get_instructions();
+        std::vector<instr_ptr_t> jumps(instrs.size(), 0);
+        for (const auto &kv : prog.get_jmp_map())
+            jumps[kv.first] = kv.second;
+        this->end = instrs.size();
+        this->states.resize(this->end + 1);
+        this->edges.resize(this->end + 1);
+        this->states[0].reached = true;
+        this->states[0].ptr = 0;
+
+        // Every change makes a state less precise, so this ends
+        std::vector<instr_ptr_t> work{0};
+        std::vector<bool> queued(this->end + 1, false);
+        queued[0] = true;
+        std::vector<std::pair<instr_ptr_t, FlowState>> out;
+        size_t visits = 0;
+        this->complete = true;
+        while (!work.empty())
+        {
+            if (++visits > MAX_FLOW_VISITS)
+            {
+                this->complete = false;
+                break;
+            }
+            instr_ptr_t pc = work.back();
+            work.pop_back();
+            queued[pc] = false;
+            if (pc == this->end)
+                continue;
+            out.clear();
+            flow_step(instrs, jumps, pc, this->states[pc], out);
+            for (const auto &kv : out)
+            {
+                FlowState joined = join(this->states[kv.first], kv.second);
+                if (joined == this->states[kv.first])
+                    continue;
+                this->states[kv.first] = joined;
+                if (!queued[kv.first])
+                {
+                    queued[kv.first] = true;
+                    work.push_back(kv.first);
+                }
+            }
+        }
+        for (instr_ptr_t pc = 0; this->complete && pc < this->end; pc++)
+        {
+            if (!this->states[pc].reached)
+                continue;
+            out.clear();
+            flow_step(instrs, jumps, pc, this->states[pc], out);
+            for (const auto &kv : out)
+                this->edges[pc].push_back(kv.first);
+        }
+
+        // Every run starts out on the walk, up to the first choice
+        KProgram kprog(prog, false);
+        this->store = std::make_unique<StateStore>(KRIPKE_MEMORY_SIZE);
+        PackedState initial;
+        initial.header = StateHeader{0, 0, std::nullopt};
+        if (kprog.chars_until_eof.has_value())
+            initial.header.remaining_stdin_chars = (unsigned int)kprog.chars_until_eof.value();
+        state_id_t state = this->store->unpack(initial);
+        std::unordered_map<state_id_t, size_t> seen;
+        std::vector<state_id_t> found;
+        this->cycle_start = NO_INDEX;
+        this->branch = NO_INDEX;
+        while (this->walk.size() < MAX_WALK_STATES)
+        {
+            auto it = seen.find(state);
+            if (it != seen.end())
+            {
+                this->cycle_start = it->second;
+                break;
+            }
+            seen.emplace(state, this->walk.size());
+            this->walk.push_back(state);
+            found.clear();
+            successors(kprog, *this->store, state, found, nullptr);
+            if (this->branch == NO_INDEX && std::any_of(found.begin(), found.end(), [&](state_id_t successor)
+                                                        { return successor != found.front(); }))
+                this->branch = this->walk.size() - 1;
+            state = found.front();
+        }
+        if (this->cycle_start == NO_INDEX)
+            this->cycle_start = this->walk.size();
+        if (this->branch == NO_INDEX)
+            this->branch = this->walk.size();
+    }
+
+    bool FlowAnalysis::is_reachable(instr_ptr_t pc) const
+    {
+        return !this->complete || this->states[std::min(pc, this->end)].reached;
+    }
+
+    // No path gets to the end or around a loop without a target on the way.
+    // Every pc a path gets to has a way on, so every path runs into one.
+    bool FlowAnalysis::always_reached(const std::vector<bool> &targets) const
+    {
+        if (targets[0])
+            return true;
+        // Depth-first, with pcs on the current path marked 1 and done ones 2
+        std::vector<uint8_t> marks(this->end + 1, 0);
+        std::vector<std::pair<instr_ptr_t, size_t>> stack{std::make_pair(0, 0)};
+        marks[0] = 1;
+        while (!stack.empty())
+        {
+            instr_ptr_t pc = stack.back().first;
+            if (pc == this->end)
+                return false;
+            if (stack.back().second == this->edges[pc].size())
+            {
+                marks[pc] = 2;
+                stack.pop_back();
+                continue;
+            }
+            instr_ptr_t next = this->edges[pc][stack.back().second++];
+            if (targets[next])
+                continue;
+            if (marks[next] == 1)
+                return false;
+            if (marks[next] == 0)
+            {
+                marks[next] = 1;
+                stack.push_back(std::make_pair(next, 0));
+            }
+        }
+        return true;
+    }
+
+    StaticVerdict FlowAnalysis::decide(const Program &prog, const std::string &label, ReachRun *run) const
+    {
+        std::vector<bool> targets(this->end + 1, false);
+        for (const auto &kv : prog.get_label_map())
+        {
+            if (kv.second == label)
+                targets[std::min(kv.first, this->end)] = true;
+        }
+
+        bool on_walk = false;
+        for (size_t i = 0; i < this->walk.size(); i++)
+        {
+            if (!targets[std::min(this->store->get_header(this->walk[i]).pc, this->end)])
+                continue;
+            if (i <= this->branch)
+                return StaticAlwaysReached;
+            on_walk = true;
+        }
+        if (this->complete && this->always_reached(targets))
+            return StaticAlwaysReached;
+
+        // A walk that came back around is a run. Without a choice it's the
+        // only one, and if no path has the label any run will do.
+        bool dead = this->complete;
+        for (instr_ptr_t pc = 0; pc <= this->end; pc++)
+        {
+            if (targets[pc] && this->states[pc].reached)
+                dead = false;
+        }
+        if (on_walk || this->cycle_start == this->walk.size() || (this->branch < this->walk.size() && !dead))
+            return StaticUnknown;
+        run->prefix.clear();
+        run->cycle.clear();
+        for (size_t i = 0; i < this->walk.size(); i++)
+            (i < this->cycle_start ? run->prefix : run->cycle).push_back(this->store->pack(this->walk[i]));
+        return StaticRunFound;
+    }
+}
\ No newline at end of file
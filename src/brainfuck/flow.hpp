@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include "program.hpp"
+#include "store.hpp"
+#include "bfs.hpp"
+
+namespace brainfuck
+{
+    // What the static analysis can tell about a label
+    enum StaticVerdict
+    {
+        StaticUnknown,       // only a search of the state space can tell
+        StaticAlwaysReached, // every run reaches the label
+        StaticRunFound       // a run that never reaches it was found
+    };
+
+    // A cell that can hold more than one value
+    const int FLOW_UNKNOWN = -1;
+
+    // Cells that aren't in cells are 0 if rest_zero, and could hold anything
+    // otherwise. A cell in cells holds its value or FLOW_UNKNOWN.
+    struct FlowState
+    {
+        bool reached = false;
+        std::optional<mem_ptr_t> ptr; // unknown if empty
+        bool rest_zero = true;
+        std::map<mem_ptr_t, int> cells;
+
+        bool operator==(const FlowState &other) const;
+    };
+
+    // Decides labels from the program alone where it can. Abstract
+    // interpretation on the control-flow graph of the brackets works out the
+    // pointer and the cells that are the same on every path to each pc, so
+    // a [ or ] on a cell known to be zero or not only goes one way. A label
+    // no path gets to is never reached. A label every path gets to, with no
+    // loop on the way that could go on forever, is always reached. On top
+    // of that the Kripke structure is followed from the initial state along
+    // the first successor of every state, and a label on it before the
+    // first choice is always reached as well.
+    class FlowAnalysis
+    {
+    private:
+        instr_ptr_t end; // pc of the end of the program
+        std::vector<FlowState> states;
+        std::vector<std::vector<instr_ptr_t>> edges; // that some path takes
+        bool complete;                               // the fixpoint was reached
+        std::unique_ptr<StateStore> store; // of the walk
+        std::vector<state_id_t> walk;
+        size_t cycle_start; // where the walk comes back to, walk.size() if it didn't
+        size_t branch;      // first state of the walk with a choice, walk.size() if none
+
+        bool always_reached(const std::vector<bool> &targets) const;
+
+    public:
+        FlowAnalysis(const Program &prog);
+        // False if no run gets to the pc
+        bool is_reachable(instr_ptr_t pc) const;
+        // For StaticRunFound, run is set to a run that misses the label,
+        // which isn't always one of the shortest
+        StaticVerdict decide(const Program &prog, const std::string &label, ReachRun *run) const;
+    };
+}
\ No newline at end of file
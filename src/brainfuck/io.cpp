@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "io.hpp"
+
+namespace brainfuck
+{
+    FdSource::FdSource(int fd)
+    {
+        this->fd = fd;
+    }
+
+    size_t FdSource::read(uint8_t *buffer, size_t size)
+    {
+        while (true)
+        {
+            ssize_t n = ::read(this->fd, buffer, size);
+            if (n >= 0)
+                return (size_t)n;
+            if (errno != EINTR)
+                return 0;
+        }
+    }
+
+    FdSink::FdSink(int fd)
+    {
+        this->fd = fd;
+    }
+
+    void FdSink::write(const uint8_t *buffer, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ::write(this->fd, buffer, size);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            buffer += n;
+            size -= (size_t)n;
+        }
+    }
+
+    MemorySource::MemorySource(std::string data)
+    {
+        this->data = data;
+        this->pos = 0;
+    }
+
+    size_t MemorySource::read(uint8_t *buffer, size_t size)
+    {
+        size_t n = std::min(size, this->data.size() - this->pos);
+        memcpy(buffer, this->data.data() + this->pos, n);
+        this->pos += n;
+        return n;
+    }
+
+    MemorySink::MemorySink()
+    {
+    }
+
+    void MemorySink::write(const uint8_t *buffer, size_t size)
+    {
+        this->data.append((const char *)buffer, size);
+    }
+
+    const std::string &MemorySink::get_data() const
+    {
+        return this->data;
+    }
+
+    BufferedWriter::BufferedWriter(OutputSink &sink)
+        : sink(sink), buffer(IO_BUFFER_SIZE)
+    {
+        this->used = 0;
+    }
+
+    BufferedWriter::~BufferedWriter()
+    {
+        this->flush();
+    }
+
+    void BufferedWriter::flush()
+    {
+        if (this->used > 0)
+            this->sink.write(this->buffer.data(), this->used);
+        this->used = 0;
+    }
+
+    BufferedReader::BufferedReader(InputSource &source, BufferedWriter *tie)
+        : source(source), buffer(IO_BUFFER_SIZE)
+    {
+        this->tie = tie;
+        this->pos = 0;
+        this->end = 0;
+    }
+
+    bool BufferedReader::refill()
+    {
+        if (this->tie != nullptr)
+            this->tie->flush();
+        this->pos = 0;
+        this->end = this->source.read(this->buffer.data(), this->buffer.size());
+        return this->end > 0;
+    }
+
+    IOChannel::IOChannel(InputSource &source, OutputSink &sink, const IOModel &io_model)
+        : writer(sink), reader(source, &writer)
+    {
+        this->no_change_on_eof = io_model.get_no_change_on_eof();
+        this->eof_char = io_model.get_eof_char();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include "model.hpp"
+
+namespace brainfuck
+{
+    const size_t IO_BUFFER_SIZE = 1 << 16;
+
+    class InputSource
+    {
+    public:
+        virtual ~InputSource() {}
+        // Reads up to size bytes and returns how many were read, 0 at the end
+        // of the input
+        virtual size_t read(uint8_t *buffer, size_t size) = 0;
+    };
+
+    class OutputSink
+    {
+    public:
+        virtual ~OutputSink() {}
+        virtual void write(const uint8_t *buffer, size_t size) = 0;
+    };
+
+    class FdSource : public InputSource
+    {
+    private:
+        int fd;
+
+    public:
+        FdSource(int fd);
+        size_t read(uint8_t *buffer, size_t size) override;
+    };
+
+    class FdSink : public OutputSink
+    {
+    private:
+        int fd;
+
+    public:
+        FdSink(int fd);
+        void write(const uint8_t *buffer, size_t size) override;
+    };
+
+    class MemorySource : public InputSource
+    {
+    private:
+        std::string data;
+        size_t pos;
+
+    public:
+        MemorySource(std::string data);
+        size_t read(uint8_t *buffer, size_t size) override;
+    };
+
+    class MemorySink : public OutputSink
+    {
+    private:
+        std::string data;
+
+    public:
+        MemorySink();
+        void write(const uint8_t *buffer, size_t size) override;
+        const std::string &get_data() const;
+    };
+
+    class BufferedWriter
+    {
+    private:
+        OutputSink &sink;
+        std::vector<uint8_t> buffer;
+        size_t used;
+
+    public:
+        BufferedWriter(OutputSink &sink);
+        ~BufferedWriter();
+        void flush();
+
+        void put(uint8_t c)
+        {
+            if (this->used == this->buffer.size())
+                this->flush();
+            this->buffer[this->used++] = c;
+        }
+    };
+
+    class BufferedReader
+    {
+    private:
+        InputSource &source;
+        BufferedWriter *tie;
+        std::vector<uint8_t> buffer;
+        size_t pos;
+        size_t end;
+        bool refill();
+
+    public:
+        // Output written to tie is flushed before blocking on more input, so
+        // prompts show up before the program waits for an answer
+        BufferedReader(InputSource &source, BufferedWriter *tie = nullptr);
+
+        // Returns the next byte or -1 at the end of the input
+        int get()
+        {
+            if (this->pos == this->end && !this->refill())
+                return -1;
+            return this->buffer[this->pos++];
+        }
+    };
+
+    // Everything the interpreters need for `,` and `.`: buffered input and
+    // output plus the IOModel's end-of-file behaviour. Buffered input that was
+    // not consumed is dropped together with the channel.
+    class IOChannel
+    {
+    private:
+        BufferedWriter writer;
+        BufferedReader reader;
+        bool no_change_on_eof;
+        uint8_t eof_char;
+
+    public:
+        IOChannel(InputSource &source, OutputSink &sink, const IOModel &io_model);
+
+        // Returns the value a cell that currently holds `current` has after `,`
+        uint32_t read(uint32_t current)
+        {
+            int c = this->reader.get();
+            if (c >= 0)
+                return (uint32_t)c;
+            return this->no_change_on_eof ? current : this->eof_char;
+        }
+
+        void write(uint8_t c)
+        {
+            this->writer.put(c);
+        }
+
+        void flush()
+        {
+            this->writer.flush();
+        }
+    };
+}
\ No newline at end of file
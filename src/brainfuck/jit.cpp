@@ -0,0 +1,474 @@
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#include <type_traits>
+#include "jit.hpp"
+#include "scan.hpp"
+
+#ifdef BRAINCHECK_JIT
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace brainfuck
+{
+#ifdef BRAINCHECK_JIT
+    struct JitContext
+    {
+        IOChannel *io;
+    };
+
+    static uint32_t jit_read(JitContext *ctx, uint32_t current)
+    {
+        return ctx->io->read(current);
+    }
+
+    static void jit_write(JitContext *ctx, uint32_t value)
+    {
+        ctx->io->write((uint8_t)value);
+    }
+
+    typedef mem_ptr_t (*JitFunction)(void *tape, mem_ptr_t ptr, JitContext *ctx);
+
+    // Register usage of the generated code:
+    //   rbx = tape base, r12 = pointer (cell index), r13 = memory size,
+    //   r14 = JitContext, eax/ecx/esi = scratch
+    // All of them but the scratch registers are callee-saved, so the I/O
+    // helpers can be called without spilling anything.
+    class Assembler
+    {
+    private:
+        std::vector<uint8_t> code;
+        unsigned int cell_bytes;
+
+        // ModRM and SIB byte for [rbx + r12 * cell_bytes]
+        void cell_operand(uint8_t reg)
+        {
+            uint8_t scale = cell_bytes == 1 ? 0x00 : cell_bytes == 2 ? 0x40
+                                                                      : 0x80;
+            this->emit({(uint8_t)((reg << 3) | 0x04), (uint8_t)(scale | 0x23)});
+        }
+
+        // Operand size prefix and REX.X for r12 as index
+        void cell_prefix()
+        {
+            if (this->cell_bytes == 2)
+                this->emit({0x66});
+            this->emit({0x42});
+        }
+
+        void cell_immediate(uint32_t value)
+        {
+            if (this->cell_bytes == 1)
+                this->emit({(uint8_t)value});
+            else if (this->cell_bytes == 2)
+                this->emit({(uint8_t)value, (uint8_t)(value >> 8)});
+            else
+                this->imm32(value);
+        }
+
+    public:
+        Assembler(unsigned int cell_bytes)
+        {
+            this->cell_bytes = cell_bytes;
+        }
+
+        const std::vector<uint8_t> &get_code() const
+        {
+            return this->code;
+        }
+
+        size_t size() const
+        {
+            return this->code.size();
+        }
+
+        void emit(std::initializer_list<uint8_t> bytes)
+        {
+            this->code.insert(this->code.end(), bytes);
+        }
+
+        void imm32(uint32_t value)
+        {
+            for (int i = 0; i < 4; i++)
+                this->code.push_back((uint8_t)(value >> (8 * i)));
+        }
+
+        void imm64(uint64_t value)
+        {
+            for (int i = 0; i < 8; i++)
+                this->code.push_back((uint8_t)(value >> (8 * i)));
+        }
+
+        void patch_rel32(size_t at, size_t target)
+        {
+            uint32_t rel = (uint32_t)((long)target - (long)(at + 4));
+            for (int i = 0; i < 4; i++)
+                this->code[at + i] = (uint8_t)(rel >> (8 * i));
+        }
+
+        void prologue(memory_size_t memory_size)
+        {
+            this->emit({0x53});             // push rbx
+            this->emit({0x41, 0x54});       // push r12
+            this->emit({0x41, 0x55});       // push r13
+            this->emit({0x41, 0x56});       // push r14
+            this->emit({0x41, 0x57});       // push r15
+            this->emit({0x48, 0x89, 0xFB}); // mov rbx, rdi
+            this->emit({0x49, 0x89, 0xF4}); // mov r12, rsi
+            this->emit({0x49, 0x89, 0xD6}); // mov r14, rdx
+            this->emit({0x49, 0xBD});       // mov r13, memory_size
+            this->imm64(memory_size);
+        }
+
+        void epilogue()
+        {
+            this->emit({0x4C, 0x89, 0xE0}); // mov rax, r12
+            this->emit({0x41, 0x5F});       // pop r15
+            this->emit({0x41, 0x5E});       // pop r14
+            this->emit({0x41, 0x5D});       // pop r13
+            this->emit({0x41, 0x5C});       // pop r12
+            this->emit({0x5B});             // pop rbx
+            this->emit({0xC3});             // ret
+        }
+
+        void add_cell(uint32_t value)
+        {
+            this->cell_prefix();
+            this->emit({(uint8_t)(this->cell_bytes == 1 ? 0x80 : 0x81)});
+            this->cell_operand(0);
+            this->cell_immediate(value);
+        }
+
+        void set_cell(uint32_t value)
+        {
+            this->cell_prefix();
+            this->emit({(uint8_t)(this->cell_bytes == 1 ? 0xC6 : 0xC7)});
+            this->cell_operand(0);
+            this->cell_immediate(value);
+        }
+
+        void compare_cell_to_zero()
+        {
+            this->cell_prefix();
+            this->emit({(uint8_t)(this->cell_bytes == 1 ? 0x80 : 0x83)});
+            this->cell_operand(7);
+            this->emit({0x00});
+        }
+
+        void load_cell()
+        {
+            // The loads zero-extend into eax, so they never take the operand
+            // size prefix
+            this->emit({0x42});
+            if (this->cell_bytes == 1)
+                this->emit({0x0F, 0xB6}); // movzx eax, byte
+            else if (this->cell_bytes == 2)
+                this->emit({0x0F, 0xB7}); // movzx eax, word
+            else
+                this->emit({0x8B}); // mov eax, dword
+            this->cell_operand(0);
+        }
+
+        void store_cell()
+        {
+            this->cell_prefix();
+            this->emit({(uint8_t)(this->cell_bytes == 1 ? 0x88 : 0x89)});
+            this->cell_operand(0);
+        }
+
+        // The pointer is kept in [0, memory_size), which is why cell
+        // accesses need no bounds checks
+        void move_wrapping(long offset)
+        {
+            this->emit({0x49, 0x81, 0xC4}); // add r12, offset
+            this->imm32((uint32_t)offset);
+            this->emit({0x4D, 0x39, 0xEC}); // cmp r12, r13
+            this->emit({0x72, 0x03});       // jb +3
+            this->emit({0x4D, 0x29, 0xEC}); // sub r12, r13
+        }
+
+        void move_clamping(long offset)
+        {
+            if (offset < 0)
+            {
+                this->emit({0x49, 0x81, 0xEC}); // sub r12, -offset
+                this->imm32((uint32_t)-offset);
+                this->emit({0x73, 0x03});       // jae +3
+                this->emit({0x45, 0x31, 0xE4}); // xor r12d, r12d
+            }
+            else
+            {
+                this->emit({0x49, 0x81, 0xC4}); // add r12, offset
+                this->imm32((uint32_t)offset);
+                this->emit({0x4D, 0x39, 0xEC}); // cmp r12, r13
+                this->emit({0x72, 0x06});       // jb +6
+                this->emit({0x4D, 0x89, 0xEC}); // mov r12, r13
+                this->emit({0x49, 0xFF, 0xCC}); // dec r12
+            }
+        }
+
+        void multiply_add(long offset, long factor)
+        {
+            this->load_cell();
+            this->emit({0x69, 0xC0}); // imul eax, eax, factor
+            this->imm32((uint32_t)factor);
+            this->emit({0x49, 0x8D, 0x8C, 0x24}); // lea rcx, [r12 + offset]
+            this->imm32((uint32_t)offset);
+            this->emit({0x4C, 0x39, 0xE9}); // cmp rcx, r13
+            this->emit({0x72, 0x03});       // jb +3
+            this->emit({0x4C, 0x29, 0xE9}); // sub rcx, r13
+            // add [rbx + rcx * cell_bytes], al/ax/eax
+            if (this->cell_bytes == 1)
+                this->emit({0x00, 0x04, 0x0B});
+            else if (this->cell_bytes == 2)
+                this->emit({0x66, 0x01, 0x04, 0x4B});
+            else
+                this->emit({0x01, 0x04, 0x8B});
+        }
+
+        void call_helper(const void *helper)
+        {
+            this->emit({0x4C, 0x89, 0xF7}); // mov rdi, r14
+            this->emit({0x48, 0xB8});       // mov rax, helper
+            this->imm64((uint64_t)(uintptr_t)helper);
+            this->emit({0xFF, 0xD0}); // call rax
+        }
+
+        // ptr = scan_zero(tape, memory_size, ptr, stride)
+        void scan(const void *helper, long stride)
+        {
+            this->emit({0x48, 0x89, 0xDF}); // mov rdi, rbx
+            this->emit({0x4C, 0x89, 0xEE}); // mov rsi, r13
+            this->emit({0x4C, 0x89, 0xE2}); // mov rdx, r12
+            this->emit({0x48, 0xB9});       // mov rcx, stride
+            this->imm64((uint64_t)stride);
+            this->emit({0x48, 0xB8}); // mov rax, helper
+            this->imm64((uint64_t)(uintptr_t)helper);
+            this->emit({0xFF, 0xD0});       // call rax
+            this->emit({0x49, 0x89, 0xC4}); // mov r12, rax
+        }
+
+        void read_cell()
+        {
+            this->load_cell();
+            this->emit({0x89, 0xC6}); // mov esi, eax
+            this->call_helper((const void *)&jit_read);
+            this->store_cell();
+        }
+
+        void write_cell()
+        {
+            this->load_cell();
+            this->emit({0x89, 0xC6}); // mov esi, eax
+            this->call_helper((const void *)&jit_write);
+        }
+
+        // Emits a conditional jump with a placeholder and returns where its
+        // displacement has to be patched
+        size_t jump_if(bool zero)
+        {
+            this->compare_cell_to_zero();
+            this->emit({0x0F, (uint8_t)(zero ? 0x84 : 0x85)}); // je/jne rel32
+            size_t at = this->code.size();
+            this->imm32(0);
+            return at;
+        }
+    };
+
+    static std::vector<uint8_t> assemble(
+        const std::vector<ByteOp> &ops,
+        unsigned int cell_bytes,
+        memory_size_t memory_size,
+        bool wrapping)
+    {
+        Assembler as(cell_bytes);
+        std::vector<size_t> op_offsets(ops.size());
+        std::vector<std::pair<size_t, size_t>> fixups;
+        const void *scan_helper;
+        if (cell_bytes == 1)
+            scan_helper = (const void *)static_cast<mem_ptr_t (*)(const uint8_t *, memory_size_t, mem_ptr_t, long)>(&scan_zero);
+        else if (cell_bytes == 2)
+            scan_helper = (const void *)static_cast<mem_ptr_t (*)(const uint16_t *, memory_size_t, mem_ptr_t, long)>(&scan_zero);
+        else
+            scan_helper = (const void *)static_cast<mem_ptr_t (*)(const uint32_t *, memory_size_t, mem_ptr_t, long)>(&scan_zero);
+
+        as.prologue(memory_size);
+        for (size_t ip = 0; ip < ops.size(); ip++)
+        {
+            const ByteOp &op = ops[ip];
+            op_offsets[ip] = as.size();
+            switch (op.code)
+            {
+            case OpCode::op_add:
+                as.add_cell((uint32_t)op.arg);
+                break;
+
+            case OpCode::op_move:
+                if (wrapping)
+                    as.move_wrapping(op.arg);
+                else
+                    as.move_clamping(op.arg);
+                break;
+
+            case OpCode::op_set:
+                as.set_cell((uint32_t)op.arg);
+                break;
+
+            case OpCode::op_mul:
+                as.multiply_add(op.offset, op.arg);
+                break;
+
+            case OpCode::op_scan:
+                as.scan(scan_helper, op.arg);
+                break;
+
+            case OpCode::op_get:
+                as.read_cell();
+                break;
+
+            case OpCode::op_put:
+                as.write_cell();
+                break;
+
+            case OpCode::op_jz:
+                fixups.push_back(std::make_pair(as.jump_if(true), (size_t)op.arg));
+                break;
+
+            case OpCode::op_jnz:
+                fixups.push_back(std::make_pair(as.jump_if(false), (size_t)op.arg));
+                break;
+
+            case OpCode::op_halt:
+                as.epilogue();
+                break;
+
+            default:
+                abort();
+            }
+        }
+
+        for (const auto &fixup : fixups)
+            as.patch_rel32(fixup.first, op_offsets[fixup.second]);
+        return as.get_code();
+    }
+
+    // Maps memory with PROT_NONE pages around it, so a stray access faults
+    // instead of corrupting the heap
+    class GuardedBuffer
+    {
+    private:
+        uint8_t *base;
+        size_t mapped;
+        size_t usable;
+
+    public:
+        GuardedBuffer(size_t bytes)
+        {
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            this->usable = ((bytes + page - 1) / page) * page;
+            this->mapped = this->usable + 2 * page;
+            void *m = mmap(nullptr, this->mapped, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            this->base = m == MAP_FAILED ? nullptr : (uint8_t *)m;
+            if (this->base != nullptr && mprotect(this->base + page, this->usable, PROT_READ | PROT_WRITE) != 0)
+            {
+                munmap(this->base, this->mapped);
+                this->base = nullptr;
+            }
+        }
+
+        ~GuardedBuffer()
+        {
+            if (this->base != nullptr)
+                munmap(this->base, this->mapped);
+        }
+
+        GuardedBuffer(const GuardedBuffer &) = delete;
+        GuardedBuffer &operator=(const GuardedBuffer &) = delete;
+
+        bool ok() const
+        {
+            return this->base != nullptr;
+        }
+
+        // Start of the usable region
+        uint8_t *begin() const
+        {
+            return this->base + (this->mapped - this->usable) / 2;
+        }
+
+        // Start of the trailing guard page
+        uint8_t *end() const
+        {
+            return this->begin() + this->usable;
+        }
+
+        bool make_executable()
+        {
+            return mprotect(this->begin(), this->usable, PROT_READ | PROT_EXEC) == 0;
+        }
+    };
+
+    bool jit_available()
+    {
+        return true;
+    }
+
+    bool run_jit(const std::vector<ByteOp> &code, MemoryModel &memory_model, IOChannel &io)
+    {
+        memory_size_t memory_size = memory_model.get_memory_size();
+        bool wrapping = memory_model.is_wrapping();
+        mem_ptr_t ptr = memory_model.get_pointer();
+        bool ran = false;
+
+        memory_model.visit_tape([&](auto &tape)
+                                {
+            typedef typename std::remove_reference<decltype(*tape.data())>::type Cell;
+            if (!tape.is_dense())
+                return;
+
+            std::vector<uint8_t> machine_code = assemble(code, sizeof(Cell), memory_size, wrapping);
+            GuardedBuffer text(machine_code.size());
+            if (!text.ok())
+                return;
+            memcpy(text.begin(), machine_code.data(), machine_code.size());
+            if (!text.make_executable())
+                return;
+
+            // The cells end right at the trailing guard page
+            size_t tape_bytes = memory_size * sizeof(Cell);
+            GuardedBuffer cells(tape_bytes);
+            if (!cells.ok())
+                return;
+            tape.materialize();
+            Cell *jit_tape = (Cell *)(cells.end() - tape_bytes);
+            memcpy(jit_tape, tape.data(), tape_bytes);
+
+            JitFunction function;
+            void *entry = text.begin();
+            memcpy(&function, &entry, sizeof(function));
+            JitContext ctx{&io};
+            ptr = function(jit_tape, ptr, &ctx);
+
+            memcpy(tape.data(), jit_tape, tape_bytes);
+            ran = true; });
+
+        if (ran)
+            memory_model.set_pointer(ptr);
+        return ran;
+    }
+#else
+    bool jit_available()
+    {
+        return false;
+    }
+
+    bool run_jit(const std::vector<ByteOp> &code, MemoryModel &memory_model, IOChannel &io)
+    {
+        (void)code;
+        (void)memory_model;
+        (void)io;
+        return false;
+    }
+#endif
+}
\ No newline at end of file
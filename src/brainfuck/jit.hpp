@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+#include "io.hpp"
+#include "model.hpp"
+#include "bytecode.hpp"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define BRAINCHECK_JIT
+#endif
+
+namespace brainfuck
+{
+    bool jit_available();
+
+    // Translates the bytecode into x86-64 machine code and runs it on the
+    // memory model's tape. Returns false without touching the memory model
+    // if the JIT is not available on this platform or the tape is paged.
+    bool run_jit(const std::vector<ByteOp> &code, MemoryModel &memory_model, IOChannel &io);
+}
\ No newline at end of file
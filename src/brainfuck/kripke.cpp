@@ -1,240 +1,407 @@
 #include <map>
 #include <vector>
 #include <iostream>
+#include <algorithm>
 #include <spot/kripke/kripke.hh>
 #include "kripke.hpp"
 
 namespace brainfuck
 {
-    template <class T>
-    void hash_combine(std::size_t &seed, const T &v)
+    KState::KState(const StateStore *store, state_id_t id)
     {
-        std::hash<T> hasher;
-        seed ^= hasher(v) * 0xABCDEF + 0x9e3779b9 + (seed << 16);
+        this->store = store;
+        this->id = id;
     }
 
-    KState::KState()
+    instr_ptr_t KState::get_instr_ptr() const
     {
-        this->pc = 0;
-        this->mem_ptr = 0;
-        std::map<mem_ptr_t, uint8_t> memory{};
-        this->memory = memory;
-        this->m_remaining_stdin_chars = std::nullopt;
+        return this->store->get_header(this->id).pc;
     }
 
-    KState::KState(instr_ptr_t pc, mem_ptr_t mem_ptr, std::map<mem_ptr_t, uint8_t> memory)
+    mem_ptr_t KState::get_mem_ptr() const
     {
-        this->pc = pc;
-        this->mem_ptr = mem_ptr;
-        this->memory = memory;
-        this->m_remaining_stdin_chars = std::nullopt;
+        return this->store->get_header(this->id).mem_ptr;
     }
 
-    KState::KState(instr_ptr_t pc,
-                   mem_ptr_t mem_ptr,
-                   std::map<mem_ptr_t, uint8_t> memory,
-                   std::optional<unsigned int> m_remaining_stdin_chars)
+    std::optional<unsigned int> KState::get_remaining_stdin_chars() const
     {
-        this->pc = pc;
-        this->mem_ptr = mem_ptr;
-        this->memory = memory;
-        this->m_remaining_stdin_chars = m_remaining_stdin_chars;
+        return this->store->get_header(this->id).remaining_stdin_chars;
     }
 
-    KState::KState(std::optional<unsigned int> m_remaining_stdin_chars)
+    uint8_t KState::get_cell(mem_ptr_t ptr) const
     {
-        this->pc = 0;
-        this->mem_ptr = 0;
-        std::map<mem_ptr_t, uint8_t> memory{};
-        this->memory = memory;
-        this->m_remaining_stdin_chars = m_remaining_stdin_chars;
+        return this->store->get_cell(this->store->get_tape(this->id), ptr);
     }
 
-    instr_ptr_t KState::get_instr_ptr() const
+    state_id_t KState::get_id() const
     {
-        return this->pc;
+        return this->id;
     }
 
-    mem_ptr_t KState::get_mem_ptr() const
+    KState *KState::clone() const
     {
-        return this->mem_ptr;
+        return new KState(this->store, this->id);
     }
 
-    std::map<mem_ptr_t, uint8_t> KState::get_memory() const
+    size_t KState::hash() const
     {
-        return this->memory;
+        return (size_t)this->id * 0x9e3779b97f4a7c15ULL;
     }
 
-    std::optional<unsigned int> KState::get_remaining_stdin_chars() const
+    int KState::compare(const spot::state *other) const
     {
-        return this->m_remaining_stdin_chars;
+        auto o = static_cast<const KState *>(other);
+        if (this->id == o->id)
+            return 0;
+        return this->id < o->id ? -1 : 1;
     }
 
-    KState *KState::clone() const
+    KProgram::KProgram(const Program &prog, bool abstract_input)
     {
-        return new KState(this->pc, this->mem_ptr, this->memory, this->m_remaining_stdin_chars);
+        this->abstract_input = abstract_input;
+        this->ops = prog.get_instructions();
+        this->jumps.assign(this->ops.size(), 0);
+        for (const auto &kv : prog.get_jmp_map())
+            this->jumps[kv.first] = kv.second;
+        // The program ends at pc == ops.size(), which can carry a label too
+        this->stops.assign(this->ops.size() + 1, false);
+        for (const auto &kv : prog.get_label_map())
+            this->stops[kv.first] = true;
+        for (instr_ptr_t pc = 0; pc < this->ops.size(); pc++)
+        {
+            if (this->ops[pc] == Instruction::get)
+                this->stops[pc] = true;
+        }
+        IOModel io_model = prog.io_model;
+        this->input_chars = io_model.get_possible_chars(std::make_optional<size_t>(1));
+        InputClasses classes(prog);
+        this->read_chars.resize(this->ops.size());
+        for (instr_ptr_t pc = 0; pc < this->ops.size(); pc++)
+        {
+            if (this->ops[pc] == Instruction::get)
+                this->read_chars[pc] = classes.get_representatives(pc);
+        }
+        this->eof_chars = io_model.get_possible_chars(std::make_optional<size_t>(0));
+        this->chars_until_eof = io_model.get_chars_until_eof();
     }
 
-    size_t KState::hash() const
+    KProgram::KProgram(const Program &prog, const std::map<instr_ptr_t, bdd> &labels, bdd unlabeled, bool abstract_input)
+        : KProgram(prog, abstract_input)
     {
-        size_t hash = 0xC0FFEE;
-        hash_combine(hash, this->pc);
-        hash_combine(hash, this->mem_ptr);
-        for (const auto &kv : this->memory)
-        {
-            if (kv.second == 0)
-                continue;
-            hash_combine(hash, kv.first);
-            hash_combine(hash, kv.second);
-        }
-        if (this->m_remaining_stdin_chars.has_value())
-            hash_combine(hash, this->m_remaining_stdin_chars.value());
-        return hash;
+        this->conditions.assign(this->ops.size() + 1, unlabeled);
+        for (const auto &kv : labels)
+            this->conditions[kv.first] = kv.second;
     }
 
-    int KState::compare(const spot::state *other) const
+    static bool has_value(const ValueSet &values, uint8_t value)
     {
-        auto o = static_cast<const KState *>(other);
+        return (values[value >> 6] >> (value & 63)) & 1;
+    }
 
-        if (this->pc != o->pc)
-        {
-            return this->pc - o->pc;
-        }
-        else if (this->mem_ptr != o->mem_ptr)
+    static unsigned int count_values(const ValueSet &values)
+    {
+        unsigned int count = 0;
+        for (uint64_t word : values)
+            count += __builtin_popcountll(word);
+        return count;
+    }
+
+    static ValueSet make_values(const std::vector<uint8_t> &chars)
+    {
+        ValueSet values{};
+        for (uint8_t c : chars)
+            values[c >> 6] |= 1ULL << (c & 63);
+        return values;
+    }
+
+    // Every value plus delta, wrapping around like the cells do
+    static ValueSet rotate(const ValueSet &values, uint8_t delta)
+    {
+        ValueSet rotated{};
+        for (unsigned int v = 0; v < 256; v++)
         {
-            return this->mem_ptr - o->mem_ptr;
+            if (has_value(values, (uint8_t)v))
+            {
+                uint8_t w = (uint8_t)(v + delta);
+                rotated[w >> 6] |= 1ULL << (w & 63);
+            }
         }
-        else if (this->m_remaining_stdin_chars.has_value())
+        return rotated;
+    }
+
+    // Id of the value set of the cell under the pointer, if it has one
+    template <typename Store>
+    static std::optional<uint32_t> abstract_values(const Store &store, const StateHeader &header)
+    {
+        if (header.abstract_cells == 0)
+            return std::nullopt;
+        const AbstractCells &cells = store.get_cells(header.abstract_cells);
+        auto it = std::lower_bound(cells.begin(), cells.end(), header.mem_ptr, [](const AbstractCell &cell, mem_ptr_t ptr)
+                                   { return cell.ptr < ptr; });
+        if (it == cells.end() || it->ptr != header.mem_ptr)
+            return std::nullopt;
+        return it->values;
+    }
+
+    // Sets the cell under the pointer to any of the given values, which is a
+    // plain byte when there is only one of them
+    template <typename Store>
+    static void write_values(Store &store, StateHeader &header, tape_id_t &tape, const ValueSet &values)
+    {
+        bool single = count_values(values) == 1;
+        if (header.abstract_cells == 0 && single)
         {
-            if (o->m_remaining_stdin_chars.has_value())
+            for (unsigned int v = 0; v < 256; v++)
             {
-                unsigned int this_chars = this->m_remaining_stdin_chars.value();
-                unsigned int other_chars = o->m_remaining_stdin_chars.value();
-                if (this_chars != other_chars)
-                {
-                    return this_chars - other_chars;
-                }
+                if (has_value(values, (uint8_t)v))
+                    tape = store.set_cell(tape, header.mem_ptr, (uint8_t)v);
             }
-            else
+            return;
+        }
+
+        AbstractCells cells = store.get_cells(header.abstract_cells);
+        auto it = std::lower_bound(cells.begin(), cells.end(), header.mem_ptr, [](const AbstractCell &cell, mem_ptr_t ptr)
+                                   { return cell.ptr < ptr; });
+        bool present = it != cells.end() && it->ptr == header.mem_ptr;
+        if (single)
+        {
+            if (present)
+                cells.erase(it);
+            for (unsigned int v = 0; v < 256; v++)
             {
-                return 1;
+                if (has_value(values, (uint8_t)v))
+                    tape = store.set_cell(tape, header.mem_ptr, (uint8_t)v);
             }
         }
-        else if (o->m_remaining_stdin_chars.has_value())
+        else
         {
-            // We already know that this->m_remaining_stdin_chars has no value
-            return -1;
+            uint32_t id = store.intern_values(values);
+            if (present)
+                it->values = id;
+            else
+                cells.insert(it, AbstractCell{header.mem_ptr, id});
+            tape = store.set_cell(tape, header.mem_ptr, 0);
         }
-        return 0;
+        header.abstract_cells = store.intern_cells(cells);
     }
 
-    KIterator::KIterator(const KState *state, Program prog, bdd cond)
-        : kripke_succ_iterator(cond)
+    template <typename Store>
+    static void write_byte(Store &store, StateHeader &header, tape_id_t &tape, uint8_t value)
     {
-        this->pos = 0;
-        this->prog = prog;
+        if (header.abstract_cells == 0)
+            tape = store.set_cell(tape, header.mem_ptr, value);
+        else
+            write_values(store, header, tape, make_values(std::vector<uint8_t>{value}));
+    }
 
-        // std::cerr << "KIterator for " << state->hash() << ": ";
+    // Whether the cell under the pointer could be zero as well as something
+    // else, so that a [ or ] on it has to branch
+    template <typename Store>
+    static bool undecided(const Store &store, const StateHeader &header)
+    {
+        auto values = abstract_values(store, header);
+        return values.has_value() && has_value(store.get_values(values.value()), 0);
+    }
 
-        instr_ptr_t pc = state->get_instr_ptr();
-        mem_ptr_t mem_ptr = state->get_mem_ptr();
-        auto memory = state->get_memory();
-        std::optional<unsigned int> m_remaining_stdin_chars = state->get_remaining_stdin_chars();
-        std::optional<unsigned int> m_new_remaining_chars;
-        if (m_remaining_stdin_chars.has_value())
-        {
-            unsigned int cur = m_remaining_stdin_chars.value();
-            m_new_remaining_chars = std::make_optional(cur > 0 ? cur - 1 : 0);
-        }
-        else
+    // Executes one instruction other than , and tells whether it jumped back
+    // to the start of a loop. A [ or ] must not be undecided.
+    template <typename Store>
+    static bool step(const KProgram &prog, Store &store, StateHeader &header, tape_id_t &tape)
+    {
+        auto values = abstract_values(store, header);
+        // Abstract cells that reach a [ or ] here are known not to be zero
+        bool zero = !values.has_value() && store.get_cell(tape, header.mem_ptr) == 0;
+        switch (prog.ops[header.pc])
         {
-            m_new_remaining_chars = std::nullopt;
-        }
+        case Instruction::left:
+            header.mem_ptr = header.mem_ptr == 0 ? KRIPKE_MEMORY_SIZE - 1 : header.mem_ptr - 1;
+            header.pc++;
+            return false;
+
+        case Instruction::right:
+            header.mem_ptr = header.mem_ptr == KRIPKE_MEMORY_SIZE - 1 ? 0 : header.mem_ptr + 1;
+            header.pc++;
+            return false;
+
+        case Instruction::inc:
+            if (values.has_value())
+                write_values(store, header, tape, rotate(store.get_values(values.value()), 1));
+            else
+                tape = store.set_cell(tape, header.mem_ptr, (uint8_t)(store.get_cell(tape, header.mem_ptr) + 1));
+            header.pc++;
+            return false;
 
-        auto current_cell = memory.count(mem_ptr) > 0 ? memory[mem_ptr] : 0;
-        auto m_instr = prog.instr_for_pc(pc);
-        std::vector<uint8_t> possible_vals;
-        if (m_instr.has_value())
-        {
-            switch (m_instr.value())
-            {
-            case Instruction::left:
-                mem_ptr = mem_ptr == 0 ? 29999 : mem_ptr - 1;
-                pc++;
-                break;
+        case Instruction::dec:
+            if (values.has_value())
+                write_values(store, header, tape, rotate(store.get_values(values.value()), 255));
+            else
+                tape = store.set_cell(tape, header.mem_ptr, (uint8_t)(store.get_cell(tape, header.mem_ptr) - 1));
+            header.pc++;
+            return false;
 
-            case Instruction::right:
-                mem_ptr = mem_ptr == 29999 ? 0 : mem_ptr + 1;
-                pc++;
-                break;
+        case Instruction::put:
+            header.pc++;
+            return false;
 
-            case Instruction::inc:
-                possible_vals.push_back((current_cell + 1) % 256);
-                pc++;
-                break;
+        case Instruction::fwd:
+            header.pc = zero ? prog.jumps[header.pc] : header.pc + 1;
+            return false;
 
-            case Instruction::dec:
-                possible_vals.push_back((current_cell - 1) % 256);
-                pc++;
-                break;
+        case Instruction::bwd:
+            if (!zero)
+            {
+                header.pc = prog.jumps[header.pc];
+                return true;
+            }
+            header.pc++;
+            return false;
 
-            case Instruction::get:
-                possible_vals = prog.io_model.get_possible_chars(m_remaining_stdin_chars);
-                if (possible_vals.size() == 0)
-                {
-                    possible_vals.push_back(current_cell);
-                }
-                pc++;
-                break;
+        default:
+            abort();
+        }
+    }
 
-            case Instruction::put:
-                pc++;
-                break;
+    static bool is_test(Instruction instr)
+    {
+        return instr == Instruction::fwd || instr == Instruction::bwd;
+    }
 
-            case Instruction::fwd:
-                if (current_cell == 0)
-                    pc = prog.get_jmp_map().at(pc);
-                else
-                    pc++;
+    // Runs on from a successor until a pc that needs a state of its own: a
+    // label, a , a [ or ] that has to branch on a value set, or the start of
+    // a loop that was just jumped back to, so that every cycle of the
+    // program is still a cycle of states
+    template <typename Store>
+    static void run_chain(const KProgram &prog, Store &store, StateHeader &header, tape_id_t &tape,
+                          bool jumped, std::vector<instr_ptr_t> *trace)
+    {
+        while (!jumped && header.pc < prog.ops.size() && !prog.stops[header.pc])
+        {
+            if (is_test(prog.ops[header.pc]) && undecided(store, header))
                 break;
+            if (trace != nullptr)
+                trace->push_back(header.pc);
+            jumped = step(prog, store, header, tape);
+        }
+    }
 
-            case Instruction::bwd:
-                if (current_cell != 0)
-                    pc = prog.get_jmp_map().at(pc);
-                else
-                    pc++;
-                break;
+    template <typename Store>
+    void successors(const KProgram &prog, Store &store, state_id_t state,
+                    std::vector<state_id_t> &states, std::vector<std::vector<instr_ptr_t>> *traces)
+    {
+        StateHeader header = store.get_header(state);
+        tape_id_t tape = store.get_tape(state);
+        instr_ptr_t pc = header.pc;
+        // A program that has ended stays where it is, so a run that ends
+        // without a label is an infinite run like any other
+        if (pc >= prog.ops.size())
+        {
+            states.push_back(state);
+            if (traces != nullptr)
+                traces->push_back(std::vector<instr_ptr_t>());
+            return;
+        }
 
-            default:
-                abort();
+        // Each branch is the state right after a choice, which then runs on
+        // like any other successor
+        struct Branch
+        {
+            StateHeader header;
+            tape_id_t tape;
+            bool jumped;
+        };
+        std::vector<Branch> branches;
+        if (prog.ops[pc] == Instruction::get)
+        {
+            // One byte for every class of input the program can tell apart
+            const std::vector<uint8_t> *possible_vals = &prog.read_chars[pc];
+            if (prog.abstract_input)
+                possible_vals = &prog.input_chars;
+            if (header.remaining_stdin_chars.has_value())
+            {
+                unsigned int cur = header.remaining_stdin_chars.value();
+                if (cur == 0)
+                    possible_vals = &prog.eof_chars;
+                header.remaining_stdin_chars = std::make_optional(cur > 0 ? cur - 1 : 0);
             }
+            header.pc++;
 
-            std::vector<KState> states;
-            if (possible_vals.empty())
+            // An empty set of characters leaves the cell unchanged
+            if (possible_vals->empty())
             {
-                std::map<mem_ptr_t, uint8_t> new_memory(memory);
-                states.push_back(KState(pc, mem_ptr, new_memory, m_new_remaining_chars));
+                branches.push_back(Branch{header, tape, false});
+            }
+            else if (prog.abstract_input)
+            {
+                write_values(store, header, tape, make_values(*possible_vals));
+                branches.push_back(Branch{header, tape, false});
             }
             else
             {
-                for (const auto &val : possible_vals)
+                branches.reserve(possible_vals->size());
+                for (uint8_t val : *possible_vals)
                 {
-                    std::map<mem_ptr_t, uint8_t> new_memory(memory);
-                    if (val == 0)
-                        new_memory.erase(mem_ptr);
-                    else
-                        new_memory[mem_ptr] = val;
-                    states.push_back(KState(pc, mem_ptr, new_memory, m_new_remaining_chars));
+                    Branch branch{header, tape, false};
+                    write_byte(store, branch.header, branch.tape, val);
+                    branches.push_back(branch);
                 }
             }
-            this->states = states;
+        }
+        else if (is_test(prog.ops[pc]) && undecided(store, header))
+        {
+            // Split the value set into zero and everything else
+            ValueSet nonzero = store.get_values(abstract_values(store, header).value());
+            nonzero[0] &= ~1ULL;
+            Branch zero_branch{header, tape, false};
+            write_byte(store, zero_branch.header, zero_branch.tape, 0);
+            Branch nonzero_branch{header, tape, false};
+            write_values(store, nonzero_branch.header, nonzero_branch.tape, nonzero);
+            for (Branch branch : {zero_branch, nonzero_branch})
+            {
+                branch.jumped = step(prog, store, branch.header, branch.tape);
+                branches.push_back(branch);
+            }
         }
         else
         {
-            this->states = {};
+            bool jumped = step(prog, store, header, tape);
+            branches.push_back(Branch{header, tape, jumped});
         }
 
-        // std::cerr << this->states.size() << " states" << std::endl;
+        states.reserve(states.size() + branches.size());
+        for (Branch &branch : branches)
+        {
+            std::vector<instr_ptr_t> trace{pc};
+            run_chain(prog, store, branch.header, branch.tape, branch.jumped, traces != nullptr ? &trace : nullptr);
+            states.push_back(store.intern(branch.header, branch.tape));
+            if (traces != nullptr)
+                traces->push_back(trace);
+        }
+    }
+
+    template void successors(const KProgram &prog, StateStore &store, state_id_t state,
+                             std::vector<state_id_t> &states, std::vector<std::vector<instr_ptr_t>> *traces);
+    template void successors(const KProgram &prog, SharedStateStore &store, state_id_t state,
+                             std::vector<state_id_t> &states, std::vector<std::vector<instr_ptr_t>> *traces);
+
+    KIterator::KIterator(const KState *state, const KProgram *prog, StateStore *store, bdd cond)
+        : kripke_succ_iterator(cond)
+    {
+        this->prog = prog;
+        this->store = store;
+        this->expand(state);
+    }
+
+    void KIterator::recycle(const KState *state, bdd cond)
+    {
+        kripke_succ_iterator::recycle(cond);
+        this->expand(state);
+    }
+
+    void KIterator::expand(const KState *state)
+    {
+        this->pos = 0;
+        this->states.clear();
+        successors(*this->prog, *this->store, state->get_id(), this->states, nullptr);
     }
 
     bool KIterator::first()
@@ -251,58 +418,69 @@ namespace brainfuck
 
     bool KIterator::done() const
     {
-        return this->pos >= this->states.size() - 1;
+        return this->pos >= this->states.size();
     }
 
     KState *KIterator::dst() const
     {
-        return this->states[this->pos].clone();
+        return new KState(this->store, this->states[this->pos]);
     }
 
-    Kripke::Kripke(Program prog, const spot::bdd_dict_ptr &d)
+    Kripke::Kripke(const Program &prog, const spot::bdd_dict_ptr &d, bool abstract_input)
         : spot::kripke(d)
     {
-        std::vector<std::pair<instr_ptr_t, bdd>> labels;
+        // Every label is true at its own pc and false everywhere else, so
+        // the condition of each pc can be worked out once up front
+        std::vector<std::pair<instr_ptr_t, bdd>> aps;
         for (const auto &kv : prog.get_label_map())
-            labels.push_back(std::make_pair(kv.first, bdd_ithvar(register_ap(kv.second))));
-        this->labels = labels;
-        this->prog = prog;
+            aps.push_back(std::make_pair(kv.first, bdd_ithvar(register_ap(kv.second))));
+        bdd unlabeled = aps.empty() ? bdd_false() : bdd_true();
+        for (const auto &ap : aps)
+            unlabeled &= !ap.second;
+        std::map<instr_ptr_t, bdd> labels;
+        for (const auto &ap : aps)
+        {
+            bdd cond = ap.second;
+            for (const auto &other : aps)
+            {
+                if (&other != &ap)
+                    cond &= !other.second;
+            }
+            labels[ap.first] = cond;
+        }
+        this->prog = std::make_shared<const KProgram>(prog, labels, unlabeled, abstract_input);
+        this->store = std::make_shared<StateStore>(KRIPKE_MEMORY_SIZE);
     }
 
     KState *Kripke::get_init_state() const
     {
-        auto m_remaining_stdin_chars = this->prog.io_model.get_chars_until_eof();
-        return new KState(m_remaining_stdin_chars);
+        StateHeader header{0, 0, std::nullopt};
+        if (this->prog->chars_until_eof.has_value())
+            header.remaining_stdin_chars = (unsigned int)this->prog->chars_until_eof.value();
+        return new KState(this->store.get(), this->store->intern(header, StateStore::EMPTY_TAPE));
     }
 
     KIterator *Kripke::succ_iter(const spot::state *s) const
     {
         auto ss = static_cast<const KState *>(s);
-        return new KIterator(ss, this->prog, state_condition(ss));
+        // Reuse the iterator Spot handed back last, along with its storage
+        if (this->iter_cache_ != nullptr)
+        {
+            auto it = static_cast<KIterator *>(this->iter_cache_);
+            this->iter_cache_ = nullptr;
+            it->recycle(ss, state_condition(ss));
+            return it;
+        }
+        return new KIterator(ss, this->prog.get(), this->store.get(), state_condition(ss));
     }
 
     bdd Kripke::state_condition(const spot::state *s) const
     {
-        bdd cond;
         auto ss = static_cast<const KState *>(s);
         instr_ptr_t pc = ss->get_instr_ptr();
-        std::pair<instr_ptr_t, bdd> head;
-        if (this->labels.size() == 0)
-        {
-            return bdd_false();
-        }
-        else
-        {
-            head = this->labels.front();
-            cond = (head.first == pc ? head.second : !head.second);
-        }
-        for (const auto &l : this->labels)
-        {
-            if (&l == &head)
-                continue;
-            cond &= (l.first == pc ? l.second : !l.second);
-        }
-        return cond;
+        if (pc >= this->prog->conditions.size())
+            return this->prog->conditions.back();
+        return this->prog->conditions[pc];
     }
 
     std::string Kripke::format_state(const spot::state *s) const
@@ -313,7 +491,32 @@ namespace brainfuck
             << ss->get_instr_ptr()
             << "; mp = "
             << ss->get_mem_ptr()
-            << "\nhash = " << ss->hash();
+            << "\nid = " << ss->get_id();
         return out.str();
     }
+
+    std::vector<instr_ptr_t> Kripke::expand_transition(const KState *from, const KState *to) const
+    {
+        // All successors of a state in a run were interned when Spot
+        // expanded it, so this adds nothing to the store
+        std::vector<state_id_t> states;
+        std::vector<std::vector<instr_ptr_t>> traces;
+        successors(*this->prog, *this->store, from->get_id(), states, &traces);
+        for (size_t i = 0; i < states.size(); i++)
+        {
+            if (states[i] == to->get_id())
+                return traces[i];
+        }
+        return std::vector<instr_ptr_t>{from->get_instr_ptr()};
+    }
+
+    KState *Kripke::make_state(const PackedState &state) const
+    {
+        return new KState(this->store.get(), this->store->unpack(state));
+    }
+
+    const StateStore &Kripke::get_store() const
+    {
+        return *this->store;
+    }
 }
\ No newline at end of file
@@ -6,40 +6,80 @@
 #include <spot/kripke/kripke.hh>
 #include "program.hpp"
 #include "model.hpp"
+#include "store.hpp"
+#include "classes.hpp"
 
 namespace brainfuck
 {
+    // A state of the Kripke structure as an id in the structure's store.
+    // Spot keeps one of these per visited state, and two states are the same
+    // exactly when their ids are.
     class KState : public spot::state
     {
     private:
-        instr_ptr_t pc;
-        mem_ptr_t mem_ptr;
-        std::map<mem_ptr_t, uint8_t> memory;
-        std::optional<unsigned int> m_remaining_stdin_chars;
+        const StateStore *store;
+        state_id_t id;
 
     public:
-        KState();
-        KState(instr_ptr_t pc, mem_ptr_t mem_ptr, std::map<mem_ptr_t, uint8_t> memory);
-        KState(instr_ptr_t pc, mem_ptr_t mem_ptr, std::map<mem_ptr_t, uint8_t> memory, std::optional<unsigned int> m_remaining_stdin_chars);
-        KState(std::optional<unsigned int> m_remaining_stdin_chars);
+        KState(const StateStore *store, state_id_t id);
         instr_ptr_t get_instr_ptr() const;
         mem_ptr_t get_mem_ptr() const;
         std::optional<unsigned int> get_remaining_stdin_chars() const;
-        std::map<mem_ptr_t, uint8_t> get_memory() const;
+        uint8_t get_cell(mem_ptr_t ptr) const;
+        state_id_t get_id() const;
         KState *clone() const override;
         size_t hash() const override;
         int compare(const spot::state *other) const override;
     };
 
+    // Cells of the tape the Kripke structure explores, which wraps around
+    const mem_ptr_t KRIPKE_MEMORY_SIZE = 30000;
+
+    // Immutable form of a program for exploring its state space, built once
+    // per Kripke structure and shared by all of its iterators
+    struct KProgram
+    {
+        std::vector<Instruction> ops;
+        std::vector<instr_ptr_t> jumps;    // target of every bracket
+        std::vector<bdd> conditions;       // state condition of every pc
+        std::vector<bool> stops;           // pcs that always get a state
+        std::vector<uint8_t> input_chars;  // values , can read before EOF
+        // Input classes of every , before EOF, one byte for each
+        std::vector<std::vector<uint8_t>> read_chars;
+        std::vector<uint8_t> eof_chars;    // values , can read at EOF
+        std::optional<size_t> chars_until_eof;
+        // A , gives one successor whose cell holds a set of values, and
+        // sets are only split where a [ or ] has to tell zero apart
+        bool abstract_input;
+
+        // Without conditions, for exploring outside of a Kripke structure
+        KProgram(const Program &prog, bool abstract_input);
+        KProgram(const Program &prog, const std::map<instr_ptr_t, bdd> &labels, bdd unlabeled, bool abstract_input);
+    };
+
+    // Successors of a state, optionally with the pcs executed to reach each.
+    // Store is a StateStore, or a SharedStateStore that other threads work
+    // in at the same time.
+    template <typename Store>
+    void successors(const KProgram &prog, Store &store, state_id_t state,
+                    std::vector<state_id_t> &states, std::vector<std::vector<instr_ptr_t>> *traces);
+
+    // Successors of a state. A transition runs through a whole stretch of
+    // deterministic instructions and only stops at labels, reads and loops
+    // that jump back, so most instructions never become a state.
     class KIterator : public spot::kripke_succ_iterator
     {
     private:
-        std::vector<KState> states;
+        std::vector<state_id_t> states;
         unsigned long pos;
-        Program prog;
+        const KProgram *prog;
+        StateStore *store;
+
+        void expand(const KState *state);
 
     public:
-        KIterator(const KState *state, Program prog, bdd cond);
+        KIterator(const KState *state, const KProgram *prog, StateStore *store, bdd cond);
+        void recycle(const KState *state, bdd cond);
         bool first() override;
         bool next() override;
         bool done() const override;
@@ -49,14 +89,20 @@ namespace brainfuck
     class Kripke : public spot::kripke
     {
     private:
-        std::vector<std::pair<instr_ptr_t, bdd>> labels;
-        Program prog;
+        std::shared_ptr<const KProgram> prog;
+        std::shared_ptr<StateStore> store;
 
     public:
-        Kripke(Program prog, const spot::bdd_dict_ptr &d);
+        Kripke(const Program &prog, const spot::bdd_dict_ptr &d, bool abstract_input = false);
         KState *get_init_state() const override;
         KIterator *succ_iter(const spot::state *s) const override;
         bdd state_condition(const spot::state *s) const override;
         std::string format_state(const spot::state *s) const override;
+        // The pcs executed on the transition between two states, from the pc
+        // of the first one up to but not including that of the second
+        std::vector<instr_ptr_t> expand_transition(const KState *from, const KState *to) const;
+        // The state with the contents of one from another store
+        KState *make_state(const PackedState &state) const;
+        const StateStore &get_store() const;
     };
 }
\ No newline at end of file
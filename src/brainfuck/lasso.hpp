@@ -0,0 +1,218 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace brainfuck
+{
+    const uint32_t NO_LASSO_NODE = std::numeric_limits<uint32_t>::max();
+
+    // Looking for shorter cycles than the first ones found stops after this
+    // many steps per state and edge, or this many steps on small graphs
+    const size_t LASSO_STEPS_PER_ITEM = 16;
+    const size_t LASSO_MIN_STEPS = 1 << 20;
+
+    // The cycle of a short run into a cycle of the graph with the successors
+    // of every node at succs[succ_start[node]] up to succs[succ_start[node +
+    // 1]], among the nodes that are left, that is no more than limit states
+    // long together with the depth of its first node. The depth of a node is
+    // how long a shortest path to it is, which the caller makes the prefix
+    // of the run. Empty if there is no such run.
+    //
+    // The strongly connected components come first, in linear time. Only a
+    // component that isn't a single node on its own holds cycles, and one
+    // that is a simple cycle has that cycle as its only one, which best
+    // starts at its shallowest node. Every other component gets a search
+    // from its shallowest node back to it. The run is the shortest of
+    // those, and then the other nodes of those components look for a
+    // shorter cycle through them until the steps run out, so on large
+    // components the run can be longer than the shortest one. The steps
+    // never run out before a run within limit was found.
+    //
+    // Array<T>(count) is a zeroed array of count elements that all the
+    // scratch space is taken from, so it can live outside of memory.
+    template <template <typename> class Array, typename Starts, typename Succs, typename Left, typename Depths>
+    std::vector<uint32_t> find_cycle(size_t count, Starts &succ_start, Succs &succs, Left &left, Depths &depths,
+                                     size_t limit)
+    {
+        std::vector<uint32_t> best_cycle;
+        size_t best = limit == std::numeric_limits<size_t>::max() ? limit : limit + 1;
+        size_t edges = succ_start[count];
+
+        // Tarjan's algorithm without recursion, numbering the components as
+        // they are completed
+        Array<uint32_t> index(count);     // order of the first visit + 1, 0 if not yet
+        Array<uint32_t> low(count);
+        Array<uint32_t> component(count); // NO_LASSO_NODE while on the stack
+        Array<uint32_t> stack(count);
+        Array<uint32_t> calls(count);
+        Array<uint64_t> positions(count);
+        size_t stack_top = 0;
+        uint32_t visits = 0;
+        uint32_t components = 0;
+        for (size_t root = 0; root < count; root++)
+        {
+            if (!left[root] || index[root] != 0)
+                continue;
+            size_t call_top = 0;
+            calls[call_top] = (uint32_t)root;
+            positions[call_top++] = succ_start[root];
+            index[root] = low[root] = ++visits;
+            component[root] = NO_LASSO_NODE;
+            stack[stack_top++] = (uint32_t)root;
+            while (call_top > 0)
+            {
+                uint32_t node = calls[call_top - 1];
+                uint64_t &position = positions[call_top - 1];
+                if (position < succ_start[node + 1])
+                {
+                    uint32_t next = succs[position++];
+                    if (!left[next])
+                        continue;
+                    if (index[next] == 0)
+                    {
+                        index[next] = low[next] = ++visits;
+                        component[next] = NO_LASSO_NODE;
+                        stack[stack_top++] = next;
+                        calls[call_top] = next;
+                        positions[call_top++] = succ_start[next];
+                    }
+                    else if (component[next] == NO_LASSO_NODE)
+                    {
+                        low[node] = std::min(low[node], index[next]);
+                    }
+                    continue;
+                }
+                call_top--;
+                if (call_top > 0)
+                {
+                    uint32_t parent = calls[call_top - 1];
+                    low[parent] = std::min(low[parent], low[node]);
+                }
+                if (low[node] != index[node])
+                    continue;
+                uint32_t member;
+                do
+                {
+                    member = stack[--stack_top];
+                    component[member] = components;
+                } while (member != node);
+                components++;
+            }
+        }
+
+        // Size, edges within and the shallowest node of every component
+        Array<uint32_t> sizes(components);
+        Array<uint64_t> inner(components);
+        Array<uint32_t> shallowest(components);
+        for (uint32_t c = 0; c < components; c++)
+            shallowest[c] = NO_LASSO_NODE;
+        for (size_t node = 0; node < count; node++)
+        {
+            if (!left[node])
+                continue;
+            uint32_t c = component[node];
+            sizes[c]++;
+            for (uint64_t i = succ_start[node]; i < succ_start[node + 1]; i++)
+            {
+                if (left[succs[i]] && component[succs[i]] == c)
+                    inner[c]++;
+            }
+            if (shallowest[c] == NO_LASSO_NODE || depths[node] < depths[shallowest[c]])
+                shallowest[c] = (uint32_t)node;
+        }
+
+        // Shortest way from a node back to itself within its component that
+        // still beats the best, breadth-first with one queue
+        Array<uint32_t> seen(count); // start + 1 of the last search that got here
+        Array<uint32_t> from(count);
+        Array<uint32_t> queue(count);
+        size_t steps = 0;
+        auto search = [&](uint32_t start)
+        {
+            uint32_t c = component[start];
+            size_t head = 0, tail = 0;
+            queue[tail++] = start;
+            seen[start] = start + 1;
+            size_t length = 0;
+            while (head < tail && depths[start] + length + 1 < best)
+            {
+                length++;
+                size_t level_end = tail;
+                for (; head < level_end; head++)
+                {
+                    uint32_t node = queue[head];
+                    for (uint64_t i = succ_start[node]; i < succ_start[node + 1]; i++)
+                    {
+                        uint32_t next = succs[i];
+                        steps++;
+                        if (!left[next] || component[next] != c)
+                            continue;
+                        if (next == start)
+                        {
+                            std::vector<uint32_t> cycle;
+                            for (uint32_t back = node; back != start; back = from[back])
+                                cycle.push_back(back);
+                            cycle.push_back(start);
+                            std::reverse(cycle.begin(), cycle.end());
+                            best = depths[start] + length;
+                            best_cycle.swap(cycle);
+                            return;
+                        }
+                        if (seen[next] == start + 1)
+                            continue;
+                        seen[next] = start + 1;
+                        from[next] = node;
+                        queue[tail++] = next;
+                    }
+                }
+            }
+        };
+
+        for (uint32_t c = 0; c < components; c++)
+        {
+            uint32_t start = shallowest[c];
+            if (inner[c] == 0 || depths[start] + 1 >= best)
+                continue;
+            if (inner[c] == sizes[c])
+            {
+                // Every node has one way on within it, all the way around
+                if (depths[start] + sizes[c] >= best)
+                    continue;
+                std::vector<uint32_t> cycle{start};
+                while (true)
+                {
+                    uint32_t node = cycle.back();
+                    uint32_t next = start;
+                    for (uint64_t i = succ_start[node]; i < succ_start[node + 1]; i++)
+                    {
+                        if (left[succs[i]] && component[succs[i]] == c)
+                            next = succs[i];
+                    }
+                    if (next == start)
+                        break;
+                    cycle.push_back(next);
+                }
+                best = depths[start] + sizes[c];
+                best_cycle.swap(cycle);
+                continue;
+            }
+            search(start);
+        }
+
+        size_t budget = std::max(LASSO_MIN_STEPS, LASSO_STEPS_PER_ITEM * (count + edges));
+        for (size_t node = 0; node < count && (best_cycle.empty() || steps < budget); node++)
+        {
+            if (!left[node] || depths[node] + 1 >= best)
+                continue;
+            uint32_t c = component[node];
+            if (inner[c] == 0 || inner[c] == sizes[c] || shallowest[c] == node)
+                continue;
+            search((uint32_t)node);
+        }
+        return best_cycle;
+    }
+}
\ No newline at end of file
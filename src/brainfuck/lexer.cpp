@@ -0,0 +1,146 @@
+#include <string>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lexer.hpp"
+#include "program.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define BRAINCHECK_SIMD_LEXER
+#endif
+
+namespace brainfuck
+{
+    bool is_significant(char c)
+    {
+        switch (c)
+        {
+        case '<':
+        case '>':
+        case '+':
+        case '-':
+        case ',':
+        case '.':
+        case '[':
+        case ']':
+        case LABEL_SEPARATOR:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+#ifdef BRAINCHECK_SIMD_LEXER
+    // Bit i is set if byte i of the block is significant. '+' ',' '-' and
+    // '.' are adjacent in ASCII and need a single range check.
+    static uint32_t significant_bytes(const char *block)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)block);
+        __m128i rebased = _mm_sub_epi8(v, _mm_set1_epi8('+'));
+        __m128i hits = _mm_cmpeq_epi8(_mm_min_epu8(rebased, _mm_set1_epi8('.' - '+')), rebased);
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, _mm_set1_epi8('[')));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, _mm_set1_epi8(']')));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, _mm_set1_epi8(LABEL_SEPARATOR)));
+        return (uint32_t)_mm_movemask_epi8(hits);
+    }
+
+    size_t find_significant(const char *source, size_t pos, size_t size)
+    {
+        // Dense code is usually hit in the first byte, don't bother loading
+        // a vector for it
+        if (pos < size && is_significant(source[pos]))
+            return pos;
+        for (; pos < size && size - pos >= 16; pos += 16)
+        {
+            uint32_t hits = significant_bytes(source + pos);
+            if (hits != 0)
+                return pos + __builtin_ctz(hits);
+        }
+        for (; pos < size; pos++)
+        {
+            if (is_significant(source[pos]))
+                return pos;
+        }
+        return size;
+    }
+#else
+    size_t find_significant(const char *source, size_t pos, size_t size)
+    {
+        for (; pos < size; pos++)
+        {
+            if (is_significant(source[pos]))
+                return pos;
+        }
+        return size;
+    }
+#endif
+
+    SourceFile::SourceFile(const char *filename)
+    {
+        this->open = false;
+        this->mapping = nullptr;
+        this->length = 0;
+
+        int fd = ::open(filename, O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        {
+            void *mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+                this->mapping = mapping;
+                this->length = (size_t)info.st_size;
+                this->open = true;
+                close(fd);
+                return;
+            }
+        }
+
+        char chunk[1 << 16];
+        while (true)
+        {
+            ssize_t n = read(fd, chunk, sizeof(chunk));
+            if (n > 0)
+                this->buffer.append(chunk, (size_t)n);
+            else if (n == 0 || errno != EINTR)
+                break;
+        }
+        this->length = this->buffer.size();
+        this->open = true;
+        close(fd);
+    }
+
+    SourceFile::~SourceFile()
+    {
+        if (this->mapping != nullptr)
+            munmap(this->mapping, this->length);
+    }
+
+    bool SourceFile::is_open() const
+    {
+        return this->open;
+    }
+
+    const char *SourceFile::data() const
+    {
+        if (this->mapping != nullptr)
+            return (const char *)this->mapping;
+        return this->buffer.data();
+    }
+
+    size_t SourceFile::size() const
+    {
+        return this->length;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <stddef.h>
+
+namespace brainfuck
+{
+    // Instruction characters and the label separator, everything else is a
+    // comment
+    bool is_significant(char c);
+
+    // Position of the first significant byte in source[pos, size) or size if
+    // there is none. Comments are skipped a vector at a time where possible.
+    size_t find_significant(const char *source, size_t pos, size_t size);
+
+    // Read-only view of a whole file. Regular files are mapped into memory,
+    // anything else (pipes, terminals) is read into a buffer.
+    class SourceFile
+    {
+    private:
+        bool open;
+        void *mapping;
+        size_t length;
+        std::string buffer;
+
+    public:
+        SourceFile(const char *filename);
+        ~SourceFile();
+        SourceFile(const SourceFile &) = delete;
+        SourceFile &operator=(const SourceFile &) = delete;
+        bool is_open() const;
+        const char *data() const;
+        size_t size() const;
+    };
+}
\ No newline at end of file
@@ -3,13 +3,32 @@
 
 namespace brainfuck
 {
+    static std::variant<Tape<uint8_t>, Tape<uint16_t>, Tape<uint32_t>>
+    make_tape(CellSize cell_size, memory_size_t size)
+    {
+        switch (cell_size)
+        {
+        case CellSize::EightBit:
+            return Tape<uint8_t>(size);
+
+        case CellSize::SixteenBit:
+            return Tape<uint16_t>(size);
+
+        case CellSize::ThirtyTwoBit:
+            return Tape<uint32_t>(size);
+
+        default:
+            abort();
+        }
+    }
+
     MemoryModel::MemoryModel(CellSize cell_size, memory_size_t size, bool wrapping)
+        : tape(make_tape(cell_size, size))
     {
         this->cell_size = cell_size;
         this->memory_size = size;
         this->wrapping = wrapping;
         this->ptr = 0;
-        this->memory = std::map<mem_ptr_t, uint32_t>();
     }
 
     MemoryModel::~MemoryModel()
@@ -19,7 +38,9 @@ namespace brainfuck
     void MemoryModel::reset()
     {
         this->ptr = 0;
-        this->memory = std::map<mem_ptr_t, uint32_t>();
+        std::visit([](auto &tape)
+                   { tape.clear(); },
+                   this->tape);
     }
 
     void MemoryModel::left()
@@ -42,22 +63,41 @@ namespace brainfuck
             this->ptr = this->memory_size - 1;
     }
 
-    void MemoryModel::increment()
+    void MemoryModel::move(long offset)
     {
-        uint32_t value = this->get_value(this->ptr);
-        if (value == this->get_max_value())
-            this->memory[this->ptr] = 0;
+        if (this->wrapping)
+        {
+            long size = (long)this->memory_size;
+            long new_ptr = ((long)this->ptr + offset % size) % size;
+            if (new_ptr < 0)
+                new_ptr += size;
+            this->ptr = (mem_ptr_t)new_ptr;
+        }
+        else if (offset < 0)
+        {
+            mem_ptr_t distance = (mem_ptr_t)(-offset);
+            this->ptr = this->ptr > distance ? this->ptr - distance : 0;
+        }
         else
-            this->memory[this->ptr] = value + 1;
+        {
+            mem_ptr_t distance = (mem_ptr_t)offset;
+            mem_ptr_t last = this->memory_size - 1;
+            this->ptr = last - this->ptr > distance ? this->ptr + distance : last;
+        }
+    }
+
+    void MemoryModel::increment()
+    {
+        std::visit([this](auto &tape)
+                   { tape.at(this->ptr)++; },
+                   this->tape);
     }
 
     void MemoryModel::decrement()
     {
-        uint32_t value = this->get_value(this->ptr);
-        if (value == 0)
-            this->memory[this->ptr] = this->get_max_value();
-        else
-            this->memory[this->ptr] = value - 1;
+        std::visit([this](auto &tape)
+                   { tape.at(this->ptr)--; },
+                   this->tape);
     }
 
     mem_ptr_t MemoryModel::get_pointer()
@@ -65,26 +105,30 @@ namespace brainfuck
         return this->ptr;
     }
 
+    void MemoryModel::set_pointer(mem_ptr_t ptr)
+    {
+        this->ptr = ptr;
+    }
+
     uint32_t MemoryModel::get_value(mem_ptr_t ptr)
     {
-        if (this->memory.count(ptr) > 0)
-            return this->memory[ptr];
-        else
-            return 0;
+        return std::visit([ptr](const auto &tape)
+                          { return (uint32_t)tape.get(ptr); },
+                          this->tape);
     }
 
     void MemoryModel::set_value(mem_ptr_t ptr, uint8_t value)
     {
-        this->memory[ptr] = (uint32_t)value;
+        this->set_value(ptr, (uint32_t)value);
     }
 
+    // Truncating to the cell type is the same as taking the value modulo
+    // the cell size
     void MemoryModel::set_value(mem_ptr_t ptr, uint32_t value)
     {
-        if (this->cell_size == CellSize::EightBit)
-            value %= UINT8_MAX + 1;
-        else if (this->cell_size == CellSize::SixteenBit)
-            value %= UINT16_MAX + 1;
-        this->memory[ptr] = value;
+        std::visit([ptr, value](auto &tape)
+                   { tape.set(ptr, value); },
+                   this->tape);
     }
 
     uint32_t MemoryModel::get_current_value()
@@ -115,6 +159,21 @@ namespace brainfuck
         }
     }
 
+    CellSize MemoryModel::get_cell_size() const
+    {
+        return this->cell_size;
+    }
+
+    memory_size_t MemoryModel::get_memory_size() const
+    {
+        return this->memory_size;
+    }
+
+    bool MemoryModel::is_wrapping() const
+    {
+        return this->wrapping;
+    }
+
     IOModel::IOModel()
     {
         this->chars_until_eof = std::nullopt;
@@ -149,13 +208,14 @@ namespace brainfuck
         this->chars_until_eof = std::make_optional(chars_until_eof);
     }
 
-    uint8_t IOModel::read_next_char()
+    uint8_t IOModel::get_eof_char() const
+    {
+        return this->eof_char;
+    }
+
+    bool IOModel::get_no_change_on_eof() const
     {
-        char in;
-        std::cin >> in;
-        if (std::cin.eof())
-            in = 0;
-        return (uint8_t)in;
+        return this->no_change_on_eof;
     }
 
     static const std::vector<uint8_t>
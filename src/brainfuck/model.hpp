@@ -4,13 +4,12 @@
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <variant>
 #include <optional>
+#include "tape.hpp"
 
 namespace brainfuck
 {
-    typedef unsigned long mem_ptr_t;
-    typedef unsigned long memory_size_t;
-
     enum CellSize
     {
         EightBit,
@@ -25,7 +24,7 @@ namespace brainfuck
         memory_size_t memory_size;
         bool wrapping;
         mem_ptr_t ptr;
-        std::map<mem_ptr_t, uint32_t> memory;
+        std::variant<Tape<uint8_t>, Tape<uint16_t>, Tape<uint32_t>> tape;
 
     public:
         MemoryModel(CellSize cell_size = EightBit, memory_size_t size = 30000, bool wrapping = true);
@@ -33,15 +32,27 @@ namespace brainfuck
         void reset();
         void left();
         void right();
+        void move(long offset);
         void increment();
         void decrement();
         mem_ptr_t get_pointer();
+        void set_pointer(mem_ptr_t ptr);
         uint32_t get_value(mem_ptr_t ptr);
         void set_value(mem_ptr_t ptr, uint8_t value);
         void set_value(mem_ptr_t ptr, uint32_t value);
         uint32_t get_current_value();
         void set_current_value(uint32_t value);
         uint32_t get_max_value() const;
+        CellSize get_cell_size() const;
+        memory_size_t get_memory_size() const;
+        bool is_wrapping() const;
+
+        // Gives interpreters direct access to the cell-size specific tape
+        template <typename F>
+        auto visit_tape(F &&f)
+        {
+            return std::visit(f, this->tape);
+        }
     };
 
     class IOModel
@@ -58,7 +69,8 @@ namespace brainfuck
         void set_eof_char(uint8_t eof_char);
         void set_no_change_on_eof(bool no_change);
         void set_chars_until_eof(size_t chars_until_eof);
-        uint8_t read_next_char();
+        uint8_t get_eof_char() const;
+        bool get_no_change_on_eof() const;
         std::vector<uint8_t> read_possible_chars();
         std::vector<uint8_t> get_possible_chars(std::optional<size_t> chars_left);
     };
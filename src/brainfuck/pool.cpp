@@ -0,0 +1,82 @@
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "pool.hpp"
+
+namespace brainfuck
+{
+    WorkStealingPool::WorkStealingPool(unsigned int threads)
+    {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        this->threads = threads > 0 ? threads : 1;
+    }
+
+    unsigned int WorkStealingPool::get_threads() const
+    {
+        return this->threads;
+    }
+
+    // Owners take tasks from the front and thieves from the back, so they
+    // only contend for the last task of a queue
+    bool WorkStealingPool::pop(WorkQueue &queue, size_t &task)
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty())
+            return false;
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    bool WorkStealingPool::steal(WorkQueue &queue, size_t &task)
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty())
+            return false;
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    void WorkStealingPool::run(size_t count, const std::function<void(size_t)> &task)
+    {
+        this->run(count, [&](size_t i, unsigned int)
+                  { task(i); });
+    }
+
+    void WorkStealingPool::run(size_t count, const std::function<void(size_t, unsigned int)> &task)
+    {
+        unsigned int workers = (size_t)this->threads < count ? this->threads : (unsigned int)count;
+        if (workers == 0)
+            return;
+
+        std::vector<WorkQueue> queues(workers);
+        for (size_t i = 0; i < count; i++)
+            queues[i % workers].tasks.push_back(i);
+
+        // No new tasks show up while running, so a worker that finds every
+        // queue empty is done
+        auto work = [&](unsigned int id)
+        {
+            size_t next;
+            while (true)
+            {
+                bool found = pop(queues[id], next);
+                for (unsigned int i = 1; !found && i < workers; i++)
+                    found = steal(queues[(id + i) % workers], next);
+                if (!found)
+                    return;
+                task(next, id);
+            }
+        };
+
+        std::vector<std::thread> helpers;
+        for (unsigned int id = 1; id < workers; id++)
+            helpers.push_back(std::thread(work, id));
+        work(0);
+        for (std::thread &helper : helpers)
+            helper.join();
+    }
+}
\ No newline at end of file
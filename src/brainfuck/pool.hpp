@@ -0,0 +1,38 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <stddef.h>
+
+namespace brainfuck
+{
+    // Runs a fixed set of independent tasks on a number of threads. Every
+    // thread starts with its own share of the tasks and steals from the
+    // others once it runs dry, so a few slow tasks don't leave threads idle.
+    class WorkStealingPool
+    {
+    private:
+        struct WorkQueue
+        {
+            std::mutex lock;
+            std::deque<size_t> tasks;
+        };
+
+        unsigned int threads;
+        static bool pop(WorkQueue &queue, size_t &task);
+        static bool steal(WorkQueue &queue, size_t &task);
+
+    public:
+        // 0 threads means one per hardware thread
+        WorkStealingPool(unsigned int threads = 0);
+        unsigned int get_threads() const;
+
+        // Calls task(0) ... task(count - 1) and returns when all are done.
+        // The calling thread works on tasks as well.
+        void run(size_t count, const std::function<void(size_t)> &task);
+        // Same, but also passes the id of the thread running the task, which
+        // is below get_threads()
+        void run(size_t count, const std::function<void(size_t, unsigned int)> &task);
+    };
+}
\ No newline at end of file
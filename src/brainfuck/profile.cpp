@@ -0,0 +1,249 @@
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <stdlib.h>
+#include "profile.hpp"
+
+namespace brainfuck
+{
+    static const size_t HISTOGRAM_BUCKETS = 65;
+    static const size_t NO_LOOP = (size_t)-1;
+
+    static size_t histogram_bucket(unsigned long iterations)
+    {
+        return iterations == 0 ? 0 : 64 - __builtin_clzl(iterations);
+    }
+
+    template <bool Dense, typename Cell>
+    static mem_ptr_t profile_tape(
+        const std::vector<Instruction> &instrs,
+        const std::vector<instr_ptr_t> &jumps,
+        const std::vector<size_t> &loop_of,
+        Tape<Cell> &tape,
+        bool wrapping,
+        IOChannel &io,
+        Profile &profile)
+    {
+        memory_size_t memory_size = tape.get_size();
+        mem_ptr_t ptr = 0;
+        mem_ptr_t high_water = 0;
+        unsigned long *hits = profile.hits.data();
+        // Iterations of every loop we are currently in, innermost last
+        std::vector<unsigned long> iterations;
+        instr_ptr_t pc = 0;
+
+        while (pc < instrs.size())
+        {
+            hits[pc]++;
+            switch (instrs[pc])
+            {
+            case Instruction::left:
+                if (ptr > 0)
+                    ptr--;
+                else if (wrapping)
+                    ptr = memory_size - 1;
+                high_water = std::max(high_water, ptr);
+                pc++;
+                break;
+
+            case Instruction::right:
+                if (ptr < memory_size - 1)
+                    ptr++;
+                else if (wrapping)
+                    ptr = 0;
+                high_water = std::max(high_water, ptr);
+                pc++;
+                break;
+
+            case Instruction::inc:
+                tape.template at<Dense>(ptr)++;
+                pc++;
+                break;
+
+            case Instruction::dec:
+                tape.template at<Dense>(ptr)--;
+                pc++;
+                break;
+
+            case Instruction::get:
+                tape.template at<Dense>(ptr) = (Cell)io.read(tape.template at<Dense>(ptr));
+                pc++;
+                break;
+
+            case Instruction::put:
+                io.write((uint8_t)tape.template at<Dense>(ptr));
+                pc++;
+                break;
+
+            // ] jumps back behind the [, so [ only runs when a loop is entered
+            case Instruction::fwd:
+                if (tape.template at<Dense>(ptr) == 0)
+                {
+                    LoopProfile &loop = profile.loops[loop_of[pc]];
+                    loop.entries++;
+                    loop.histogram[0]++;
+                    pc = jumps[pc];
+                }
+                else
+                {
+                    iterations.push_back(1);
+                    pc++;
+                }
+                break;
+
+            case Instruction::bwd:
+                if (tape.template at<Dense>(ptr) != 0)
+                {
+                    iterations.back()++;
+                    pc = jumps[pc];
+                }
+                else
+                {
+                    LoopProfile &loop = profile.loops[loop_of[pc]];
+                    loop.entries++;
+                    loop.iterations += iterations.back();
+                    loop.histogram[histogram_bucket(iterations.back())]++;
+                    iterations.pop_back();
+                    pc++;
+                }
+                break;
+
+            default:
+                abort();
+            }
+        }
+        profile.high_water = high_water;
+        return ptr;
+    }
+
+    Profile run_profiled(Program &prog, InputSource &input, OutputSink &output)
+    {
+        const std::vector<Instruction> &instrs = prog.get_instructions();
+        Profile profile;
+        profile.hits.assign(instrs.size(), 0);
+        profile.high_water = 0;
+
+        // Flat tables instead of map lookups in the loop, both [ and ] know
+        // which loop they belong to
+        std::vector<instr_ptr_t> jumps(instrs.size(), 0);
+        std::vector<size_t> loop_of(instrs.size(), NO_LOOP);
+        for (const auto &kv : prog.get_jmp_map())
+            jumps[kv.first] = kv.second;
+        for (instr_ptr_t pc = 0; pc < instrs.size(); pc++)
+        {
+            if (instrs[pc] != Instruction::fwd)
+                continue;
+            instr_ptr_t close = jumps[pc] - 1;
+            loop_of[pc] = loop_of[close] = profile.loops.size();
+            profile.loops.push_back(LoopProfile{pc, close, 0, 0, 0, std::vector<unsigned long>(HISTOGRAM_BUCKETS, 0)});
+        }
+
+        prog.memory_model.reset();
+        bool wrapping = prog.memory_model.is_wrapping();
+        IOChannel io(input, output, prog.io_model);
+        mem_ptr_t ptr = 0;
+        prog.memory_model.visit_tape([&](auto &tape)
+                                     {
+            tape.materialize();
+            if (tape.is_dense())
+                ptr = profile_tape<true>(instrs, jumps, loop_of, tape, wrapping, io, profile);
+            else
+                ptr = profile_tape<false>(instrs, jumps, loop_of, tape, wrapping, io, profile); });
+        prog.memory_model.set_pointer(ptr);
+        io.flush();
+
+        // Everything else is derived from the hit counts
+        profile.steps = 0;
+        std::vector<unsigned long> executed_before(instrs.size() + 1, 0);
+        for (instr_ptr_t pc = 0; pc < instrs.size(); pc++)
+        {
+            profile.steps += profile.hits[pc];
+            executed_before[pc + 1] = profile.steps;
+        }
+        for (LoopProfile &loop : profile.loops)
+            loop.instructions = executed_before[loop.close + 1] - executed_before[loop.open];
+        return profile;
+    }
+
+    void Profile::print_report(std::ostream &out, const Program &prog, size_t max_loops) const
+    {
+        const std::vector<Instruction> &instrs = prog.get_instructions();
+        out << this->steps << " instructions executed, highest cell reached: "
+            << this->high_water << std::endl;
+
+        std::vector<const LoopProfile *> ranked;
+        for (const LoopProfile &loop : this->loops)
+        {
+            if (loop.instructions > 0)
+                ranked.push_back(&loop);
+        }
+        std::stable_sort(ranked.begin(), ranked.end(), [](const LoopProfile *a, const LoopProfile *b)
+                         { return a->instructions > b->instructions; });
+        if (ranked.size() > max_loops)
+            ranked.resize(max_loops);
+        if (ranked.empty())
+            return;
+
+        out << std::endl
+            << "Hot loops:" << std::endl;
+        for (const LoopProfile *loop : ranked)
+        {
+            double share = this->steps > 0 ? 100.0 * loop->instructions / this->steps : 0;
+            std::string source;
+            for (instr_ptr_t pc = loop->open; pc <= loop->close && source.size() < 40; pc++)
+                source.push_back(instr_char(instrs[pc]));
+            if (loop->close - loop->open + 1 > source.size())
+                source += "...";
+
+            out << std::fixed << std::setprecision(1) << std::setw(5) << share << "%  "
+                << "pc " << loop->open << "-" << loop->close << "  "
+                << loop->entries << " entries, " << loop->iterations << " iterations  "
+                << source << std::endl;
+
+            out << "        iterations:";
+            for (size_t k = 0; k < loop->histogram.size(); k++)
+            {
+                if (loop->histogram[k] == 0)
+                    continue;
+                if (k == 0)
+                    out << " 0";
+                else if (k == 1)
+                    out << " 1";
+                else
+                    out << " " << (1UL << (k - 1)) << "-" << ((1UL << (k - 1)) * 2 - 1);
+                out << ":" << loop->histogram[k];
+            }
+            out << std::endl;
+        }
+    }
+
+    void Profile::write_json(std::ostream &out) const
+    {
+        out << "{\"steps\":" << this->steps
+            << ",\"high_water\":" << this->high_water
+            << ",\"hits\":[";
+        for (size_t pc = 0; pc < this->hits.size(); pc++)
+            out << (pc > 0 ? "," : "") << this->hits[pc];
+        out << "],\"loops\":[";
+        for (size_t i = 0; i < this->loops.size(); i++)
+        {
+            const LoopProfile &loop = this->loops[i];
+            // Trailing empty buckets are left out
+            size_t buckets = loop.histogram.size();
+            while (buckets > 0 && loop.histogram[buckets - 1] == 0)
+                buckets--;
+            out << (i > 0 ? "," : "")
+                << "{\"open\":" << loop.open
+                << ",\"close\":" << loop.close
+                << ",\"entries\":" << loop.entries
+                << ",\"iterations\":" << loop.iterations
+                << ",\"instructions\":" << loop.instructions
+                << ",\"histogram\":[";
+            for (size_t k = 0; k < buckets; k++)
+                out << (k > 0 ? "," : "") << loop.histogram[k];
+            out << "]}";
+        }
+        out << "]}" << std::endl;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include "program.hpp"
+#include "io.hpp"
+
+namespace brainfuck
+{
+    struct LoopProfile
+    {
+        instr_ptr_t open;  // pc of [
+        instr_ptr_t close; // pc of the matching ]
+        unsigned long entries;
+        unsigned long iterations;
+        // Instructions executed between the brackets, including nested loops
+        unsigned long instructions;
+        // histogram[0] counts entries that skipped the loop, histogram[k]
+        // entries with between 2^(k-1) and 2^k - 1 iterations
+        std::vector<unsigned long> histogram;
+    };
+
+    struct Profile
+    {
+        unsigned long steps;
+        std::vector<unsigned long> hits; // per instruction
+        std::vector<LoopProfile> loops;  // in order of their [
+        mem_ptr_t high_water;            // highest cell the pointer reached
+
+        // Human-readable summary with the loops that executed the most
+        // instructions first
+        void print_report(std::ostream &out, const Program &prog, size_t max_loops = 10) const;
+        void write_json(std::ostream &out) const;
+    };
+
+    // Runs the program one instruction at a time without any of the
+    // bytecode optimizations and records where the time goes. This is a
+    // separate engine so that Program::run pays nothing for it.
+    Profile run_profiled(Program &prog, InputSource &input, OutputSink &output);
+}
\ No newline at end of file
@@ -1,12 +1,15 @@
 #include <map>
-#include <stack>
 #include <vector>
 #include <utility>
-#include <fstream>
+#include <iterator>
 #include <iostream>
 #include <optional>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "program.hpp"
+#include "bytecode.hpp"
+#include "lexer.hpp"
 
 using namespace std;
 
@@ -41,28 +44,6 @@ namespace brainfuck
     {
     }
 
-    void Program::build_jmp_map()
-    {
-        stack<instr_ptr_t> fwd_stack;
-        instr_ptr_t old_ip, ip = 0;
-
-        for (const Instruction &op : this->ops)
-        {
-            if (op == Instruction::fwd)
-            {
-                fwd_stack.push(ip);
-            }
-            else if (op == Instruction::bwd)
-            {
-                old_ip = fwd_stack.top();
-                this->jmp_map.insert(make_pair(ip, old_ip + 1));
-                this->jmp_map.insert(make_pair(old_ip, ip + 1));
-                fwd_stack.pop();
-            }
-            ip++;
-        }
-    }
-
     void Program::print(bool without_label)
     {
         instr_ptr_t pc = 0;
@@ -81,65 +62,20 @@ namespace brainfuck
         cout << endl;
     }
 
-    void Program::run()
+    void Program::run(Engine engine)
     {
-        this->memory_model.reset();
-        instr_ptr_t ip = 0;
-        uint8_t in;
-
-        while (ip < this->ops.size())
-        {
-            switch (this->ops[ip])
-            {
-            case Instruction::left:
-                this->memory_model.left();
-                ip++;
-                break;
-
-            case Instruction::right:
-                this->memory_model.right();
-                ip++;
-                break;
-
-            case Instruction::inc:
-                this->memory_model.increment();
-                ip++;
-                break;
-
-            case Instruction::dec:
-                this->memory_model.decrement();
-                ip++;
-                break;
-
-            case Instruction::get:
-                in = this->io_model.read_next_char();
-                this->memory_model.set_current_value(in);
-                ip++;
-                break;
-
-            case Instruction::put:
-                cout << ((char)this->memory_model.get_current_value());
-                ip++;
-                break;
-
-            case Instruction::fwd:
-                if (this->memory_model.get_current_value() == 0)
-                    ip = this->jmp_map.at(ip);
-                else
-                    ip++;
-                break;
-
-            case Instruction::bwd:
-                if (this->memory_model.get_current_value() != 0)
-                    ip = this->jmp_map.at(ip);
-                else
-                    ip++;
-                break;
+        // The program writes to the file descriptor directly, so anything
+        // still sitting in cout's buffer has to go out first
+        cout.flush();
+        FdSource input(STDIN_FILENO);
+        FdSink output(STDOUT_FILENO);
+        this->run(input, output, engine);
+    }
 
-            default:
-                abort();
-            }
-        }
+    void Program::run(InputSource &input, OutputSink &output, Engine engine)
+    {
+        this->memory_model.reset();
+        Bytecode::compile(*this).run(this->memory_model, this->io_model, input, output, engine);
     }
 
     bool Program::has_label(string label)
@@ -160,6 +96,11 @@ namespace brainfuck
             return std::nullopt;
     }
 
+    const vector<Instruction> &Program::get_instructions() const
+    {
+        return this->ops;
+    }
+
     std::optional<std::string> Program::label_for_instr_ptr(instr_ptr_t ip)
     {
         try
@@ -173,130 +114,130 @@ namespace brainfuck
         }
     }
 
-    map<instr_ptr_t, string> Program::get_label_map()
+    const map<instr_ptr_t, string> &Program::get_label_map() const
     {
         return this->label_map;
     }
 
-    map<instr_ptr_t, instr_ptr_t> Program::get_jmp_map()
+    const map<instr_ptr_t, instr_ptr_t> &Program::get_jmp_map() const
     {
         return this->jmp_map;
     }
 
+    // "line 3, column 7" for a byte offset into the source
+    static string source_position(const char *source, size_t offset)
+    {
+        size_t line = 1;
+        size_t line_start = 0;
+        for (size_t i = 0; i < offset; i++)
+        {
+            if (source[i] == '\n')
+            {
+                line++;
+                line_start = i + 1;
+            }
+        }
+        return "line " + to_string(line) + ", column " + to_string(offset - line_start + 1);
+    }
+
     Program Program::parse_from_file(
         const char *filename, MemoryModel memory_model, IOModel io_model)
     {
-        ifstream file;
-        file.open(filename);
+        SourceFile file(filename);
         if (!file.is_open())
         {
             throw ParseException("Could not open file");
         }
-        Program prog = parse_from_istream(&file, memory_model, io_model);
-        file.close();
-        return prog;
+        return parse_from_buffer(file.data(), file.size(), memory_model, io_model);
     }
 
     Program Program::parse_from_istream(
         istream *stream, MemoryModel memory_model, IOModel io_model)
+    {
+        string source((istreambuf_iterator<char>(*stream)), istreambuf_iterator<char>());
+        return parse_from_buffer(source.data(), source.size(), memory_model, io_model);
+    }
+
+    Program Program::parse_from_buffer(
+        const char *source, size_t size, MemoryModel memory_model, IOModel io_model)
     {
         Program prog;
-        vector<Instruction> ops;
-        map<instr_ptr_t, string> labels;
-        int ic;
-        char c;
-        int jump_counter = 0;
+        // Program counter and source offset of every open [
+        vector<pair<instr_ptr_t, size_t>> open_loops;
         instr_ptr_t pc = 0;
 
         prog.memory_model = memory_model;
         prog.io_model = io_model;
 
-        while ((ic = stream->get()) != EOF)
+        // Ops, labels and jumps are all filled in by this one pass
+        for (size_t pos = find_significant(source, 0, size); pos < size;
+             pos = find_significant(source, pos + 1, size))
         {
-            c = (char)ic;
-            bool reading_label = false;
-            switch (c)
+            switch (source[pos])
             {
             case '<':
-                pc++;
-                ops.push_back(left);
+                prog.ops.push_back(left);
                 break;
 
             case '>':
-                pc++;
-                ops.push_back(right);
+                prog.ops.push_back(right);
                 break;
 
             case '+':
-                pc++;
-                ops.push_back(inc);
+                prog.ops.push_back(inc);
                 break;
 
             case '-':
-                pc++;
-                ops.push_back(dec);
+                prog.ops.push_back(dec);
                 break;
 
             case ',':
-                pc++;
-                ops.push_back(get);
+                prog.ops.push_back(get);
                 break;
 
             case '.':
-                pc++;
-                ops.push_back(put);
+                prog.ops.push_back(put);
                 break;
 
             case '[':
-                pc++;
-                jump_counter += 1;
-                ops.push_back(fwd);
+                open_loops.push_back(make_pair(pc, pos));
+                prog.ops.push_back(fwd);
                 break;
 
             case ']':
-                pc++;
-                jump_counter -= 1;
-                ops.push_back(bwd);
+                if (open_loops.empty())
+                {
+                    throw ParseException("Unmatched ']' at " + source_position(source, pos));
+                }
+                prog.jmp_map.insert(make_pair(pc, open_loops.back().first + 1));
+                prog.jmp_map.insert(make_pair(open_loops.back().first, pc + 1));
+                open_loops.pop_back();
+                prog.ops.push_back(bwd);
                 break;
 
             case LABEL_SEPARATOR:
-                reading_label = true;
-                break;
-
-            default:
-                break;
-            }
-
-            if (jump_counter < 0)
             {
-                throw ParseException("Jump instructions are not balanced");
+                // The label runs up to the next separator or the end of input
+                const char *label_start = source + pos + 1;
+                const char *label_end = (const char *)memchr(label_start, LABEL_SEPARATOR, size - pos - 1);
+                if (label_end == nullptr)
+                    label_end = source + size;
+                prog.label_map.insert(make_pair(pc, string(label_start, label_end)));
+                pos = (size_t)(label_end - source);
+                continue;
             }
 
-            // We have started reading a label, so we read the rest
-            if (reading_label)
-            {
-                string label;
-                while ((ic = stream->get()) != EOF)
-                {
-                    c = (char)ic;
-                    if (c == LABEL_SEPARATOR)
-                    {
-                        break;
-                    }
-                    label.push_back(c);
-                }
-                labels.insert(make_pair(pc, label));
+            default:
+                abort();
             }
+            pc++;
         }
 
-        if (jump_counter != 0)
+        if (!open_loops.empty())
         {
-            throw ParseException("Jump instructions are not balanced");
+            throw ParseException("Unmatched '[' at " + source_position(source, open_loops.back().second));
         }
 
-        prog.ops = ops;
-        prog.label_map = labels;
-        prog.build_jmp_map();
         return prog;
     }
 }
\ No newline at end of file
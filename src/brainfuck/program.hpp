@@ -4,6 +4,7 @@
 #include <vector>
 #include <iostream>
 #include <optional>
+#include "io.hpp"
 #include "model.hpp"
 
 namespace brainfuck
@@ -24,6 +25,14 @@ namespace brainfuck
         bwd    // ]
     };
 
+    // Interpreter backends for Program::run
+    enum Engine
+    {
+        SwitchDispatch,   // portable switch loop
+        ThreadedDispatch, // computed goto, falls back to the switch loop
+        Jit               // native x86-64 code, falls back to threaded dispatch
+    };
+
     char instr_char(Instruction);
 
     class Program
@@ -32,21 +41,24 @@ namespace brainfuck
         std::vector<Instruction> ops;
         std::map<instr_ptr_t, std::string> label_map;
         std::map<instr_ptr_t, instr_ptr_t> jmp_map;
-        void build_jmp_map();
 
     public:
         Program();
         MemoryModel memory_model;
         IOModel io_model;
         void print(bool without_label = false);
-        void run();
+        // Runs the program with stdin as its input and stdout as its output
+        void run(Engine engine = Engine::ThreadedDispatch);
+        void run(InputSource &input, OutputSink &output, Engine engine = Engine::ThreadedDispatch);
         bool has_label(std::string label);
         std::optional<Instruction> instr_for_pc(instr_ptr_t pc);
+        const std::vector<Instruction> &get_instructions() const;
         std::optional<std::string> label_for_instr_ptr(instr_ptr_t ip);
-        std::map<instr_ptr_t, std::string> get_label_map();
-        std::map<instr_ptr_t, instr_ptr_t> get_jmp_map();
+        const std::map<instr_ptr_t, std::string> &get_label_map() const;
+        const std::map<instr_ptr_t, instr_ptr_t> &get_jmp_map() const;
         static Program parse_from_file(const char *filename, MemoryModel memory_model, IOModel io_model);
         static Program parse_from_istream(std::istream *stream, MemoryModel memory_model, IOModel io_model);
+        static Program parse_from_buffer(const char *source, size_t size, MemoryModel memory_model, IOModel io_model);
     };
 
     class ParseException : public std::exception
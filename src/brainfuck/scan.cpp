@@ -0,0 +1,214 @@
+#include <stdint.h>
+#include "scan.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define BRAINCHECK_SIMD_SCAN
+#endif
+
+namespace brainfuck
+{
+    static const mem_ptr_t NOT_FOUND = (mem_ptr_t)-1;
+
+    // First zero cell in from, from + stride, ... below end, or end
+    template <typename Cell>
+    static mem_ptr_t find_forward_scalar(const Cell *cells, mem_ptr_t from, mem_ptr_t end, mem_ptr_t stride)
+    {
+        for (mem_ptr_t p = from; p < end; p += stride)
+        {
+            if (cells[p] == 0)
+                return p;
+        }
+        return end;
+    }
+
+    // First zero cell in from, from - stride, ... down to 0, or NOT_FOUND
+    template <typename Cell>
+    static mem_ptr_t find_backward_scalar(const Cell *cells, mem_ptr_t from, mem_ptr_t stride)
+    {
+        for (mem_ptr_t p = from;; p -= stride)
+        {
+            if (cells[p] == 0)
+                return p;
+            if (p < stride)
+                return NOT_FOUND;
+        }
+    }
+
+#ifdef BRAINCHECK_SIMD_SCAN
+    // Bits of a byte-wise movemask that belong to every stride-th cell of a
+    // vector with `width` cells. Counting starts at the lowest lane when
+    // scanning forward and at the highest lane when scanning backward.
+    template <typename Cell>
+    static uint32_t lane_mask(mem_ptr_t width, mem_ptr_t stride, bool forward)
+    {
+        uint32_t mask = 0;
+        for (mem_ptr_t i = 0; i < width; i += stride)
+        {
+            mem_ptr_t lane = forward ? i : width - 1 - i;
+            mask |= 1U << (lane * sizeof(Cell));
+        }
+        return mask;
+    }
+
+    // Compares a vector of cells against zero and returns a byte-wise mask
+    struct Sse2
+    {
+        static const mem_ptr_t bytes = 16;
+
+        template <typename Cell>
+        static uint32_t zero_lanes(const Cell *at)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)at);
+            __m128i zero = _mm_setzero_si128();
+            if constexpr (sizeof(Cell) == 1)
+                return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+            else if constexpr (sizeof(Cell) == 2)
+                return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(v, zero));
+            else
+                return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi32(v, zero));
+        }
+    };
+
+    struct Avx2
+    {
+        static const mem_ptr_t bytes = 32;
+
+        template <typename Cell>
+        __attribute__((target("avx2"))) static uint32_t zero_lanes(const Cell *at)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)at);
+            __m256i zero = _mm256_setzero_si256();
+            if constexpr (sizeof(Cell) == 1)
+                return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+            else if constexpr (sizeof(Cell) == 2)
+                return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, zero));
+            else
+                return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(v, zero));
+        }
+    };
+
+    // The vector loops only handle strides that divide the number of cells
+    // per vector, since then the same lane mask fits every block. Other
+    // strides and the ends of the tape are scanned one cell at a time.
+    template <typename Vector, typename Cell>
+    static mem_ptr_t find_forward_vector(const Cell *cells, mem_ptr_t from, mem_ptr_t end, mem_ptr_t stride)
+    {
+        const mem_ptr_t width = Vector::bytes / sizeof(Cell);
+        if (width % stride != 0)
+            return find_forward_scalar(cells, from, end, stride);
+
+        const uint32_t mask = lane_mask<Cell>(width, stride, true);
+        mem_ptr_t p = from;
+        for (; p < end && end - p >= width; p += width)
+        {
+            uint32_t hits = Vector::zero_lanes(cells + p) & mask;
+            if (hits != 0)
+                return p + __builtin_ctz(hits) / sizeof(Cell);
+        }
+        return find_forward_scalar(cells, p, end, stride);
+    }
+
+    template <typename Vector, typename Cell>
+    static mem_ptr_t find_backward_vector(const Cell *cells, mem_ptr_t from, mem_ptr_t stride)
+    {
+        const mem_ptr_t width = Vector::bytes / sizeof(Cell);
+        if (width % stride != 0)
+            return find_backward_scalar(cells, from, stride);
+
+        const uint32_t mask = lane_mask<Cell>(width, stride, false);
+        mem_ptr_t p = from;
+        while (p + 1 >= width)
+        {
+            mem_ptr_t block = p + 1 - width;
+            uint32_t hits = Vector::zero_lanes(cells + block) & mask;
+            if (hits != 0)
+                return block + (31 - __builtin_clz(hits)) / sizeof(Cell);
+            if (p < width)
+                return NOT_FOUND;
+            p -= width;
+        }
+        return find_backward_scalar(cells, p, stride);
+    }
+
+    static bool has_avx2()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    template <typename Cell>
+    static mem_ptr_t find_forward(const Cell *cells, mem_ptr_t from, mem_ptr_t end, mem_ptr_t stride)
+    {
+        if (has_avx2())
+            return find_forward_vector<Avx2>(cells, from, end, stride);
+        return find_forward_vector<Sse2>(cells, from, end, stride);
+    }
+
+    template <typename Cell>
+    static mem_ptr_t find_backward(const Cell *cells, mem_ptr_t from, mem_ptr_t stride)
+    {
+        if (has_avx2())
+            return find_backward_vector<Avx2>(cells, from, stride);
+        return find_backward_vector<Sse2>(cells, from, stride);
+    }
+#else
+    template <typename Cell>
+    static mem_ptr_t find_forward(const Cell *cells, mem_ptr_t from, mem_ptr_t end, mem_ptr_t stride)
+    {
+        return find_forward_scalar(cells, from, end, stride);
+    }
+
+    template <typename Cell>
+    static mem_ptr_t find_backward(const Cell *cells, mem_ptr_t from, mem_ptr_t stride)
+    {
+        return find_backward_scalar(cells, from, stride);
+    }
+#endif
+
+    template <typename Cell>
+    static mem_ptr_t scan(const Cell *cells, memory_size_t size, mem_ptr_t ptr, long stride)
+    {
+        if (stride > 0)
+        {
+            mem_ptr_t step = (mem_ptr_t)stride;
+            while (true)
+            {
+                mem_ptr_t hit = find_forward(cells, ptr, size, step);
+                if (hit < size)
+                    return hit;
+                // Continue at the first position past the end of the tape
+                mem_ptr_t steps = (size - ptr + step - 1) / step;
+                ptr = ptr + steps * step - size;
+            }
+        }
+        else
+        {
+            mem_ptr_t step = (mem_ptr_t)-stride;
+            while (true)
+            {
+                mem_ptr_t hit = find_backward(cells, ptr, step);
+                if (hit != NOT_FOUND)
+                    return hit;
+                // Continue at the first position before the start of the tape
+                mem_ptr_t steps = ptr / step + 1;
+                ptr = ptr + size - steps * step;
+            }
+        }
+    }
+
+    mem_ptr_t scan_zero(const uint8_t *cells, memory_size_t size, mem_ptr_t ptr, long stride)
+    {
+        return scan(cells, size, ptr, stride);
+    }
+
+    mem_ptr_t scan_zero(const uint16_t *cells, memory_size_t size, mem_ptr_t ptr, long stride)
+    {
+        return scan(cells, size, ptr, stride);
+    }
+
+    mem_ptr_t scan_zero(const uint32_t *cells, memory_size_t size, mem_ptr_t ptr, long stride)
+    {
+        return scan(cells, size, ptr, stride);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+#include "tape.hpp"
+
+namespace brainfuck
+{
+    // Runs a scan loop like [>], [<<] or [>>>>] on a dense tape: starting at
+    // ptr, moves by stride (wrapping around at size) until it finds a zero
+    // cell and returns its position. Like the loop itself, this never returns
+    // if there is no zero cell on the way.
+    mem_ptr_t scan_zero(const uint8_t *cells, memory_size_t size, mem_ptr_t ptr, long stride);
+    mem_ptr_t scan_zero(const uint16_t *cells, memory_size_t size, mem_ptr_t ptr, long stride);
+    mem_ptr_t scan_zero(const uint32_t *cells, memory_size_t size, mem_ptr_t ptr, long stride);
+}
\ No newline at end of file
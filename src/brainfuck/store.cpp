@@ -0,0 +1,492 @@
+#include <string.h>
+#include "store.hpp"
+
+namespace brainfuck
+{
+    static const size_t INITIAL_SLOTS = 1 << 10;
+    static const size_t INITIAL_SHARD_SLOTS = 1 << 4;
+
+    static uint64_t mix(uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    static void put_u32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        uint8_t bytes[sizeof(value)];
+        memcpy(bytes, &value, sizeof(value));
+        out.insert(out.end(), bytes, bytes + sizeof(value));
+    }
+
+    static uint32_t get_u32(const uint8_t *&data)
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        return value;
+    }
+
+    void encode_state(const PackedState &state, std::vector<uint8_t> &out)
+    {
+        put_u32(out, (uint32_t)state.header.pc);
+        put_u32(out, (uint32_t)state.header.mem_ptr);
+        const auto &remaining = state.header.remaining_stdin_chars;
+        put_u32(out, remaining.has_value() ? remaining.value() + 1 : 0);
+        put_u32(out, (uint32_t)state.cells.size());
+        for (const auto &cell : state.cells)
+        {
+            put_u32(out, (uint32_t)cell.first);
+            out.push_back(cell.second);
+        }
+        put_u32(out, (uint32_t)state.abstract_cells.size());
+        for (const auto &cell : state.abstract_cells)
+        {
+            put_u32(out, (uint32_t)cell.first);
+            const uint8_t *values = (const uint8_t *)cell.second.data();
+            out.insert(out.end(), values, values + sizeof(ValueSet));
+        }
+    }
+
+    PackedState decode_state(const uint8_t *data)
+    {
+        PackedState state;
+        state.header.pc = get_u32(data);
+        state.header.mem_ptr = get_u32(data);
+        uint32_t remaining = get_u32(data);
+        if (remaining > 0)
+            state.header.remaining_stdin_chars = remaining - 1;
+        uint32_t cells = get_u32(data);
+        for (uint32_t i = 0; i < cells; i++)
+        {
+            mem_ptr_t ptr = get_u32(data);
+            state.cells.push_back(std::make_pair(ptr, *data++));
+        }
+        uint32_t abstract_cells = get_u32(data);
+        for (uint32_t i = 0; i < abstract_cells; i++)
+        {
+            mem_ptr_t ptr = get_u32(data);
+            ValueSet values;
+            memcpy(values.data(), data, sizeof(ValueSet));
+            data += sizeof(ValueSet);
+            state.abstract_cells.push_back(std::make_pair(ptr, values));
+        }
+        return state;
+    }
+
+    template <typename Key, typename Hash>
+    InternTable<Key, Hash>::InternTable()
+    {
+        this->slots.assign(INITIAL_SLOTS, 0);
+    }
+
+    template <typename Key, typename Hash>
+    void InternTable<Key, Hash>::grow()
+    {
+        std::vector<uint32_t> slots(this->slots.size() * 2, 0);
+        size_t mask = slots.size() - 1;
+        for (uint32_t id = 0; id < this->keys.size(); id++)
+        {
+            size_t slot = Hash()(this->keys[id]) & mask;
+            while (slots[slot] != 0)
+                slot = (slot + 1) & mask;
+            slots[slot] = id + 1;
+        }
+        this->slots.swap(slots);
+    }
+
+    template <typename Key, typename Hash>
+    uint32_t InternTable<Key, Hash>::intern(const Key &key)
+    {
+        // Open addressing with linear probing, kept at most half full
+        size_t mask = this->slots.size() - 1;
+        size_t slot = Hash()(key) & mask;
+        while (this->slots[slot] != 0)
+        {
+            uint32_t id = this->slots[slot] - 1;
+            if (this->keys[id] == key)
+                return id;
+            slot = (slot + 1) & mask;
+        }
+
+        uint32_t id = (uint32_t)this->keys.size();
+        this->keys.push_back(key);
+        this->slots[slot] = id + 1;
+        if (this->keys.size() * 2 > this->slots.size())
+            this->grow();
+        return id;
+    }
+
+    template <typename Key, typename Hash>
+    size_t InternTable<Key, Hash>::memory_usage() const
+    {
+        return this->keys.capacity() * sizeof(Key) + this->slots.capacity() * sizeof(uint32_t);
+    }
+
+    bool AbstractCell::operator==(const AbstractCell &other) const
+    {
+        return this->ptr == other.ptr && this->values == other.values;
+    }
+
+    bool StateHeader::operator==(const StateHeader &other) const
+    {
+        return this->pc == other.pc &&
+               this->mem_ptr == other.mem_ptr &&
+               this->remaining_stdin_chars == other.remaining_stdin_chars &&
+               this->abstract_cells == other.abstract_cells;
+    }
+
+    bool PackedState::operator==(const PackedState &other) const
+    {
+        return this->header == other.header &&
+               this->cells == other.cells &&
+               this->abstract_cells == other.abstract_cells;
+    }
+
+    size_t PageHash::operator()(const StorePage &page) const
+    {
+        uint64_t hash = 0;
+        for (size_t i = 0; i < STORE_PAGE_SIZE; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, page.data() + i, sizeof(word));
+            hash = mix(hash ^ word);
+        }
+        return hash;
+    }
+
+    size_t PairHash::operator()(uint64_t pair) const
+    {
+        return mix(pair + 0x9e3779b97f4a7c15ULL);
+    }
+
+    size_t HeaderHash::operator()(const StateHeader &header) const
+    {
+        uint64_t hash = mix(header.pc + 0x9e3779b97f4a7c15ULL);
+        hash = mix(hash ^ header.mem_ptr);
+        if (header.remaining_stdin_chars.has_value())
+            hash = mix(hash ^ (header.remaining_stdin_chars.value() + 1ULL));
+        return mix(hash ^ header.abstract_cells);
+    }
+
+    size_t ValueSetHash::operator()(const ValueSet &values) const
+    {
+        uint64_t hash = 0;
+        for (uint64_t word : values)
+            hash = mix(hash ^ word);
+        return hash;
+    }
+
+    size_t AbstractCellsHash::operator()(const AbstractCells &cells) const
+    {
+        uint64_t hash = cells.size();
+        for (const AbstractCell &cell : cells)
+            hash = mix(hash ^ ((uint64_t)cell.ptr << 32 | cell.values));
+        return hash;
+    }
+
+    size_t PackedStateHash::operator()(const PackedState &state) const
+    {
+        uint64_t hash = HeaderHash()(state.header) ^ this->seed;
+        for (const auto &cell : state.cells)
+            hash = mix(hash ^ ((uint64_t)cell.first << 8 | cell.second));
+        for (const auto &cell : state.abstract_cells)
+            hash = mix(hash ^ cell.first ^ ValueSetHash()(cell.second));
+        return hash;
+    }
+
+    template class InternTable<StorePage, PageHash>;
+    template class InternTable<uint64_t, PairHash>;
+    template class InternTable<StateHeader, HeaderHash>;
+    template class InternTable<ValueSet, ValueSetHash>;
+    template class InternTable<AbstractCells, AbstractCellsHash>;
+
+    template <typename Key, typename Hash>
+    SharedInternTable<Key, Hash>::SharedInternTable()
+    {
+        for (Shard &shard : this->shards)
+            shard.slots.assign(INITIAL_SHARD_SLOTS, 0);
+        for (auto &block : this->blocks)
+            block.store(nullptr, std::memory_order_relaxed);
+        this->count = 0;
+    }
+
+    template <typename Key, typename Hash>
+    SharedInternTable<Key, Hash>::~SharedInternTable()
+    {
+        for (auto &block : this->blocks)
+            delete[] block.load();
+    }
+
+    // Block b holds the 2^b << FIRST_BLOCK_BITS ids after those of the
+    // blocks before it
+    template <typename Key, typename Hash>
+    unsigned int SharedInternTable<Key, Hash>::block_of(uint32_t id)
+    {
+        return 31 - __builtin_clz((id >> FIRST_BLOCK_BITS) + 1);
+    }
+
+    template <typename Key, typename Hash>
+    Key &SharedInternTable<Key, Hash>::slot_for(uint32_t id)
+    {
+        unsigned int block = block_of(id);
+        Key *keys = this->blocks[block].load(std::memory_order_acquire);
+        if (keys == nullptr)
+        {
+            // Threads in other shards may get here at the same time, and
+            // only one of them gets to put its block in
+            Key *fresh = new Key[(size_t)1 << (block + FIRST_BLOCK_BITS)];
+            if (this->blocks[block].compare_exchange_strong(keys, fresh, std::memory_order_acq_rel))
+                keys = fresh;
+            else
+                delete[] fresh;
+        }
+        return keys[id - (((1U << block) - 1) << FIRST_BLOCK_BITS)];
+    }
+
+    template <typename Key, typename Hash>
+    void SharedInternTable<Key, Hash>::grow(Shard &shard)
+    {
+        std::vector<uint32_t> slots(shard.slots.size() * 2, 0);
+        size_t mask = slots.size() - 1;
+        for (uint32_t slot : shard.slots)
+        {
+            if (slot == 0)
+                continue;
+            size_t index = Hash()(this->at(slot - 1)) & mask;
+            while (slots[index] != 0)
+                index = (index + 1) & mask;
+            slots[index] = slot;
+        }
+        shard.slots.swap(slots);
+    }
+
+    template <typename Key, typename Hash>
+    uint32_t SharedInternTable<Key, Hash>::intern(const Key &key)
+    {
+        // The slots take the low bits of the hash, so pick the shard by the high
+        size_t hash = Hash()(key);
+        Shard &shard = this->shards[hash >> (sizeof(size_t) * 8 - SHARD_BITS)];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        size_t mask = shard.slots.size() - 1;
+        size_t slot = hash & mask;
+        while (shard.slots[slot] != 0)
+        {
+            uint32_t id = shard.slots[slot] - 1;
+            if (this->at(id) == key)
+                return id;
+            slot = (slot + 1) & mask;
+        }
+
+        // Whoever learns the id from here on does so through this lock or
+        // after it, and sees the key
+        uint32_t id = this->count.fetch_add(1);
+        this->slot_for(id) = key;
+        shard.slots[slot] = id + 1;
+        if (++shard.count * 2 > shard.slots.size())
+            this->grow(shard);
+        return id;
+    }
+
+    template <typename Key, typename Hash>
+    size_t SharedInternTable<Key, Hash>::memory_usage() const
+    {
+        size_t bytes = 0;
+        for (const Shard &shard : this->shards)
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            bytes += shard.slots.capacity() * sizeof(uint32_t);
+        }
+        for (unsigned int block = 0; block < MAX_BLOCKS; block++)
+        {
+            if (this->blocks[block].load() != nullptr)
+                bytes += ((size_t)1 << (block + FIRST_BLOCK_BITS)) * sizeof(Key);
+        }
+        return bytes;
+    }
+
+    template class SharedInternTable<StorePage, PageHash>;
+    template class SharedInternTable<uint64_t, PairHash>;
+    template class SharedInternTable<StateHeader, HeaderHash>;
+    template class SharedInternTable<ValueSet, ValueSetHash>;
+    template class SharedInternTable<AbstractCells, AbstractCellsHash>;
+
+    template <template <typename, typename> class Table>
+    TreeStateStore<Table>::TreeStateStore(mem_ptr_t memory_size)
+    {
+        this->levels = 0;
+        while (((mem_ptr_t)STORE_PAGE_SIZE << this->levels) < memory_size)
+            this->levels++;
+
+        // Id 0 is the zero page on the lowest level and a pair of zeros on
+        // every level above, so untouched parts of the tape cost nothing
+        StorePage zero;
+        zero.fill(0);
+        this->pages.intern(zero);
+        this->pairs.intern(0);
+        this->abstract_cells.intern(AbstractCells());
+    }
+
+    template <template <typename, typename> class Table>
+    uint32_t TreeStateStore<Table>::make_pair(uint32_t left, uint32_t right)
+    {
+        return this->pairs.intern((uint64_t)left << 32 | right);
+    }
+
+    template <template <typename, typename> class Table>
+    uint8_t TreeStateStore<Table>::get_cell(tape_id_t tape, mem_ptr_t ptr) const
+    {
+        uint32_t id = tape;
+        for (unsigned int level = this->levels; level > 0 && id != 0; level--)
+        {
+            uint64_t pair = this->pairs.at(id);
+            bool right = (ptr >> (STORE_PAGE_BITS + level - 1)) & 1;
+            id = right ? (uint32_t)pair : (uint32_t)(pair >> 32);
+        }
+        return this->pages.at(id)[ptr & (STORE_PAGE_SIZE - 1)];
+    }
+
+    template <template <typename, typename> class Table>
+    tape_id_t TreeStateStore<Table>::set_cell(tape_id_t tape, mem_ptr_t ptr, uint8_t value)
+    {
+        // Walk down remembering the sibling on every level, then intern a
+        // new path back up
+        uint32_t siblings[sizeof(mem_ptr_t) * 8];
+        uint32_t id = tape;
+        for (unsigned int level = this->levels; level > 0; level--)
+        {
+            uint64_t pair = this->pairs.at(id);
+            bool right = (ptr >> (STORE_PAGE_BITS + level - 1)) & 1;
+            siblings[level - 1] = right ? (uint32_t)(pair >> 32) : (uint32_t)pair;
+            id = right ? (uint32_t)pair : (uint32_t)(pair >> 32);
+        }
+
+        StorePage page = this->pages.at(id);
+        if (page[ptr & (STORE_PAGE_SIZE - 1)] == value)
+            return tape;
+        page[ptr & (STORE_PAGE_SIZE - 1)] = value;
+        id = this->pages.intern(page);
+
+        for (unsigned int level = 1; level <= this->levels; level++)
+        {
+            bool right = (ptr >> (STORE_PAGE_BITS + level - 1)) & 1;
+            if (right)
+                id = this->make_pair(siblings[level - 1], id);
+            else
+                id = this->make_pair(id, siblings[level - 1]);
+        }
+        return id;
+    }
+
+    template <template <typename, typename> class Table>
+    state_id_t TreeStateStore<Table>::intern(const StateHeader &header, tape_id_t tape)
+    {
+        uint32_t header_id = this->headers.intern(header);
+        return this->states.intern((uint64_t)header_id << 32 | tape);
+    }
+
+    template <template <typename, typename> class Table>
+    const StateHeader &TreeStateStore<Table>::get_header(state_id_t state) const
+    {
+        return this->headers.at((uint32_t)(this->states.at(state) >> 32));
+    }
+
+    template <template <typename, typename> class Table>
+    tape_id_t TreeStateStore<Table>::get_tape(state_id_t state) const
+    {
+        return (tape_id_t)this->states.at(state);
+    }
+
+    template <template <typename, typename> class Table>
+    uint32_t TreeStateStore<Table>::intern_values(const ValueSet &values)
+    {
+        return this->value_sets.intern(values);
+    }
+
+    template <template <typename, typename> class Table>
+    const ValueSet &TreeStateStore<Table>::get_values(uint32_t id) const
+    {
+        return this->value_sets.at(id);
+    }
+
+    template <template <typename, typename> class Table>
+    uint32_t TreeStateStore<Table>::intern_cells(const AbstractCells &cells)
+    {
+        return this->abstract_cells.intern(cells);
+    }
+
+    template <template <typename, typename> class Table>
+    const AbstractCells &TreeStateStore<Table>::get_cells(uint32_t id) const
+    {
+        return this->abstract_cells.at(id);
+    }
+
+    template <template <typename, typename> class Table>
+    void TreeStateStore<Table>::collect_cells(uint32_t id, unsigned int level, mem_ptr_t base,
+                                              std::vector<std::pair<mem_ptr_t, uint8_t>> &cells) const
+    {
+        // Zero subtrees hold nothing worth listing
+        if (id == 0)
+            return;
+        if (level == 0)
+        {
+            const StorePage &page = this->pages.at(id);
+            for (mem_ptr_t i = 0; i < STORE_PAGE_SIZE; i++)
+            {
+                if (page[i] != 0)
+                    cells.push_back(std::make_pair(base + i, page[i]));
+            }
+            return;
+        }
+        uint64_t pair = this->pairs.at(id);
+        this->collect_cells((uint32_t)(pair >> 32), level - 1, base, cells);
+        this->collect_cells((uint32_t)pair, level - 1, base + (STORE_PAGE_SIZE << (level - 1)), cells);
+    }
+
+    template <template <typename, typename> class Table>
+    PackedState TreeStateStore<Table>::pack(state_id_t state) const
+    {
+        PackedState packed;
+        packed.header = this->get_header(state);
+        this->collect_cells(this->get_tape(state), this->levels, 0, packed.cells);
+        for (const AbstractCell &cell : this->get_cells(packed.header.abstract_cells))
+            packed.abstract_cells.push_back(std::make_pair(cell.ptr, this->get_values(cell.values)));
+        packed.header.abstract_cells = 0;
+        return packed;
+    }
+
+    template <template <typename, typename> class Table>
+    state_id_t TreeStateStore<Table>::unpack(const PackedState &state)
+    {
+        StateHeader header = state.header;
+        tape_id_t tape = EMPTY_TAPE;
+        for (const auto &cell : state.cells)
+            tape = this->set_cell(tape, cell.first, cell.second);
+        if (!state.abstract_cells.empty())
+        {
+            AbstractCells cells;
+            for (const auto &cell : state.abstract_cells)
+                cells.push_back(AbstractCell{cell.first, this->intern_values(cell.second)});
+            header.abstract_cells = this->intern_cells(cells);
+        }
+        return this->intern(header, tape);
+    }
+
+    template <template <typename, typename> class Table>
+    size_t TreeStateStore<Table>::state_count() const
+    {
+        return this->states.size();
+    }
+
+    template <template <typename, typename> class Table>
+    size_t TreeStateStore<Table>::memory_usage() const
+    {
+        return this->pages.memory_usage() + this->pairs.memory_usage() +
+               this->headers.memory_usage() + this->states.memory_usage() +
+               this->value_sets.memory_usage() + this->abstract_cells.memory_usage();
+    }
+
+    template class TreeStateStore<InternTable>;
+    template class TreeStateStore<SharedInternTable>;
+}
\ No newline at end of file
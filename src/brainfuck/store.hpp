@@ -0,0 +1,223 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <stdint.h>
+#include <stddef.h>
+#include "tape.hpp"
+#include "program.hpp"
+
+namespace brainfuck
+{
+    typedef uint32_t state_id_t;
+    typedef uint32_t tape_id_t;
+
+    // Hash table that hands out consecutive ids for distinct keys and keeps
+    // every key exactly once, in the order it was first seen
+    template <typename Key, typename Hash>
+    class InternTable
+    {
+    private:
+        std::vector<Key> keys;
+        std::vector<uint32_t> slots; // id + 1 of the key in every slot, 0 if empty
+
+        void grow();
+
+    public:
+        InternTable();
+        uint32_t intern(const Key &key);
+        const Key &at(uint32_t id) const
+        {
+            return this->keys[id];
+        }
+        size_t size() const
+        {
+            return this->keys.size();
+        }
+        size_t memory_usage() const;
+    };
+
+    const unsigned int STORE_PAGE_BITS = 6;
+    const mem_ptr_t STORE_PAGE_SIZE = 1 << STORE_PAGE_BITS;
+
+    typedef std::array<uint8_t, STORE_PAGE_SIZE> StorePage;
+
+    // Bit v is set if a cell can hold the value v
+    typedef std::array<uint64_t, 4> ValueSet;
+
+    // A cell that stands for more than one value, with the id of its set
+    struct AbstractCell
+    {
+        mem_ptr_t ptr;
+        uint32_t values;
+
+        bool operator==(const AbstractCell &other) const;
+    };
+
+    // Sorted by ptr. The tape holds 0 for each of these cells.
+    typedef std::vector<AbstractCell> AbstractCells;
+
+    struct StateHeader
+    {
+        instr_ptr_t pc;
+        mem_ptr_t mem_ptr;
+        std::optional<unsigned int> remaining_stdin_chars;
+        uint32_t abstract_cells = 0; // id of the AbstractCells, 0 for none
+
+        bool operator==(const StateHeader &other) const;
+    };
+
+    // A state that doesn't depend on any store: its header without an id
+    // for abstract cells, every cell that isn't zero and every abstract cell
+    // with its values, all by increasing pointer
+    struct PackedState
+    {
+        StateHeader header;
+        std::vector<std::pair<mem_ptr_t, uint8_t>> cells;
+        std::vector<std::pair<mem_ptr_t, ValueSet>> abstract_cells;
+
+        bool operator==(const PackedState &other) const;
+    };
+
+    // The bytes of a state, equal exactly when the states are
+    void encode_state(const PackedState &state, std::vector<uint8_t> &out);
+    // The state back from bytes of encode_state
+    PackedState decode_state(const uint8_t *data);
+
+    struct PageHash
+    {
+        size_t operator()(const StorePage &page) const;
+    };
+
+    struct PairHash
+    {
+        size_t operator()(uint64_t pair) const;
+    };
+
+    struct HeaderHash
+    {
+        size_t operator()(const StateHeader &header) const;
+    };
+
+    struct ValueSetHash
+    {
+        size_t operator()(const ValueSet &values) const;
+    };
+
+    struct AbstractCellsHash
+    {
+        size_t operator()(const AbstractCells &cells) const;
+    };
+
+    // Different seeds give hashes that collide independently
+    struct PackedStateHash
+    {
+        uint64_t seed = 0;
+        size_t operator()(const PackedState &state) const;
+    };
+
+    // InternTable that any number of threads can add to at once. Keys are
+    // spread over shards by hash, each behind a lock of its own, while ids
+    // come from one counter and stay dense. Keys live in blocks that double
+    // in size and never move, so looking one up by id needs no lock.
+    template <typename Key, typename Hash>
+    class SharedInternTable
+    {
+    private:
+        static const unsigned int SHARD_BITS = 6;
+        static const unsigned int FIRST_BLOCK_BITS = 10;
+        static const unsigned int MAX_BLOCKS = 32 - FIRST_BLOCK_BITS + 1;
+
+        struct Shard
+        {
+            mutable std::mutex lock;
+            std::vector<uint32_t> slots; // id + 1 of the key in every slot, 0 if empty
+            size_t count = 0;
+        };
+        std::array<Shard, 1 << SHARD_BITS> shards;
+        std::array<std::atomic<Key *>, MAX_BLOCKS> blocks;
+        std::atomic<uint32_t> count;
+
+        static unsigned int block_of(uint32_t id);
+        Key &slot_for(uint32_t id);
+        void grow(Shard &shard);
+
+    public:
+        SharedInternTable();
+        ~SharedInternTable();
+        SharedInternTable(const SharedInternTable &) = delete;
+        SharedInternTable &operator=(const SharedInternTable &) = delete;
+        uint32_t intern(const Key &key);
+        const Key &at(uint32_t id) const
+        {
+            unsigned int block = block_of(id);
+            uint32_t first = ((1U << block) - 1) << FIRST_BLOCK_BITS;
+            return this->blocks[block].load(std::memory_order_acquire)[id - first];
+        }
+        size_t size() const
+        {
+            return this->count.load();
+        }
+        size_t memory_usage() const;
+    };
+
+    // Tree compressed database of Kripke states, after the one in LTSmin.
+    // The tape is cut into pages, and pages, pairs of pages, pairs of pairs
+    // and so on up to a single root are each interned, so a tape is one id
+    // and equal parts of different tapes are stored once. A state is the
+    // pair of an interned header and a tape, and ends up as one dense id
+    // that is equal for two states exactly when their contents are. Table
+    // is the kind of table every part is interned in.
+    template <template <typename, typename> class Table>
+    class TreeStateStore
+    {
+    private:
+        unsigned int levels; // pair levels above the pages
+        Table<StorePage, PageHash> pages;
+        Table<uint64_t, PairHash> pairs;
+        Table<StateHeader, HeaderHash> headers;
+        Table<uint64_t, PairHash> states;
+        Table<ValueSet, ValueSetHash> value_sets;
+        Table<AbstractCells, AbstractCellsHash> abstract_cells;
+
+        uint32_t make_pair(uint32_t left, uint32_t right);
+        void collect_cells(uint32_t id, unsigned int level, mem_ptr_t base,
+                           std::vector<std::pair<mem_ptr_t, uint8_t>> &cells) const;
+
+    public:
+        TreeStateStore(mem_ptr_t memory_size);
+
+        // Id of the tape with every cell zero
+        static const tape_id_t EMPTY_TAPE = 0;
+        uint8_t get_cell(tape_id_t tape, mem_ptr_t ptr) const;
+        tape_id_t set_cell(tape_id_t tape, mem_ptr_t ptr, uint8_t value);
+
+        state_id_t intern(const StateHeader &header, tape_id_t tape);
+        const StateHeader &get_header(state_id_t state) const;
+        tape_id_t get_tape(state_id_t state) const;
+
+        uint32_t intern_values(const ValueSet &values);
+        const ValueSet &get_values(uint32_t id) const;
+        uint32_t intern_cells(const AbstractCells &cells);
+        const AbstractCells &get_cells(uint32_t id) const;
+
+        // Moves states between stores
+        PackedState pack(state_id_t state) const;
+        state_id_t unpack(const PackedState &state);
+
+        size_t state_count() const;
+        // Bytes held by all the tables together
+        size_t memory_usage() const;
+    };
+
+    typedef TreeStateStore<InternTable> StateStore;
+
+    // The same store for many threads at once, which all see the same ids
+    // for the same states, pages and pairs
+    typedef TreeStateStore<SharedInternTable> SharedStateStore;
+    typedef state_id_t shared_state_id_t;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+namespace brainfuck
+{
+    typedef unsigned long mem_ptr_t;
+    typedef unsigned long memory_size_t;
+
+    // Tapes up to this many cells are stored in one contiguous array
+    const memory_size_t DENSE_TAPE_LIMIT = 1 << 22;
+    // Larger tapes are split into pages that are only allocated when written
+    const unsigned int TAPE_PAGE_BITS = 16;
+    const memory_size_t TAPE_PAGE_SIZE = 1 << TAPE_PAGE_BITS;
+
+    // Memory of a brainfuck program with the cell width fixed at compile
+    // time. Arithmetic on Cell wraps around by itself since it is unsigned.
+    // No storage is allocated until the first write, so copying an unused
+    // tape is cheap.
+    template <typename Cell>
+    class Tape
+    {
+    private:
+        memory_size_t size;
+        bool dense;
+        std::vector<Cell> cells;
+        std::vector<std::vector<Cell>> pages;
+
+        Cell &page_cell(mem_ptr_t ptr)
+        {
+            if (this->pages.empty())
+                this->pages.resize((this->size + TAPE_PAGE_SIZE - 1) >> TAPE_PAGE_BITS);
+            std::vector<Cell> &page = this->pages[ptr >> TAPE_PAGE_BITS];
+            if (page.empty())
+                page.resize(TAPE_PAGE_SIZE, 0);
+            return page[ptr & (TAPE_PAGE_SIZE - 1)];
+        }
+
+    public:
+        Tape(memory_size_t size)
+        {
+            this->size = size;
+            this->dense = size <= DENSE_TAPE_LIMIT;
+        }
+
+        memory_size_t get_size() const
+        {
+            return this->size;
+        }
+
+        bool is_dense() const
+        {
+            return this->dense;
+        }
+
+        // Allocates the dense array up front so that at<true> needs no checks
+        void materialize()
+        {
+            if (this->dense && this->cells.empty())
+                this->cells.resize(this->size, 0);
+        }
+
+        void clear()
+        {
+            this->cells.clear();
+            this->pages.clear();
+        }
+
+        Cell get(mem_ptr_t ptr) const
+        {
+            if (this->dense)
+                return ptr < this->cells.size() ? this->cells[ptr] : 0;
+            mem_ptr_t page = ptr >> TAPE_PAGE_BITS;
+            if (page >= this->pages.size() || this->pages[page].empty())
+                return 0;
+            return this->pages[page][ptr & (TAPE_PAGE_SIZE - 1)];
+        }
+
+        void set(mem_ptr_t ptr, Cell value)
+        {
+            this->at(ptr) = value;
+        }
+
+        Cell &at(mem_ptr_t ptr)
+        {
+            if (this->dense)
+            {
+                this->materialize();
+                return this->cells[ptr];
+            }
+            return this->page_cell(ptr);
+        }
+
+        // Access for interpreters that have already checked is_dense() and
+        // called materialize()
+        template <bool Dense>
+        Cell &at(mem_ptr_t ptr)
+        {
+            if constexpr (Dense)
+                return this->cells[ptr];
+            else
+                return this->page_cell(ptr);
+        }
+
+        Cell *data()
+        {
+            return this->dense ? this->cells.data() : nullptr;
+        }
+    };
+}
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <unistd.h>
 #include <argparse.hpp>
 #include <brainfuck.hpp>
 #include <spot/twaalgos/dot.hh>
@@ -44,10 +48,53 @@ auto parse_bf_program =
     }
 };
 
-ap::ExecuteFun exfun = [](std::string filename)
+ap::ExecuteFun exfun = [](std::string filename, bf::Engine engine, bool profile, std::string profile_out)
 {
     auto prog = parse_bf_program(filename);
-    prog.run();
+    if (!profile)
+    {
+        prog.run(engine);
+        return;
+    }
+
+    bf::FdSource input(STDIN_FILENO);
+    bf::FdSink output(STDOUT_FILENO);
+    bf::Profile result = bf::run_profiled(prog, input, output);
+    result.print_report(std::cerr, prog);
+    if (!profile_out.empty())
+    {
+        std::ofstream file(profile_out);
+        if (!file.is_open())
+        {
+            std::cerr << RED_BOLD;
+            std::cerr << "Could not write profile to " << profile_out << std::endl;
+            std::cerr << RESET;
+            exit(1);
+        }
+        result.write_json(file);
+    }
+};
+
+ap::CompileFun compfun = [](std::string filename, std::string output, std::string compiler, bool emit_c)
+{
+    auto prog = parse_bf_program(filename);
+    if (emit_c)
+    {
+        std::cout << bf::generate_c(prog);
+        return;
+    }
+
+    try
+    {
+        bf::compile_native(prog, output, compiler);
+    }
+    catch (bf::CompileException &ce)
+    {
+        std::cerr << RED_BOLD;
+        std::cerr << "Compile error: " << ce.what() << std::endl;
+        std::cerr << RESET;
+        exit(1);
+    }
 };
 
 ap::PrintFun pfun = [](std::string filename, bool without_label)
@@ -63,69 +110,210 @@ ap::DotFun dotfun = [](std::string filename)
     spot::print_dot(std::cout, k, "N");
 };
 
-ap::CheckReachFun crfun = [](std::string filename, std::string label, bf::IOModel io_model)
+// Prints a run on which the label is never reached, with the bytes it reads
+auto print_run = [](bf::Program &prog, const std::string &label, const spot::twa_run_ptr &run)
 {
-    bf::Program prog = parse_bf_program(filename, bf::MemoryModel(), io_model);
+    std::cerr << RED_BOLD;
+    std::cout
+        << "There exists a run for which the label \""
+        << label
+        << "\" will not be reached:"
+        << std::endl;
+    bf::instr_ptr_t last_ptr = 0;
+    // States of the run can stand for many instructions each
+    auto trace = bf::expand_run(run);
+    std::cout << BLUE_BOLD;
+    for (auto pc : trace.prefix)
+    {
+        auto instr = prog.instr_for_pc(pc);
+        std::cout << bf::instr_char(instr.value());
+    }
+    std::cout << RED_BOLD;
+    for (auto pc : trace.cycle)
+    {
+        auto instr = prog.instr_for_pc(pc);
+        std::cout << bf::instr_char(instr.value());
+        last_ptr = pc;
+    }
+    // A run that ends has nothing left to repeat
+    if (trace.cycle.empty() && !trace.prefix.empty())
+        last_ptr = trace.prefix.back();
+    std::cout << BLUE_BOLD;
+    for (bf::instr_ptr_t i = last_ptr + 1; true; i++)
+    {
+        auto m_label = prog.label_for_instr_ptr(i);
+        if (m_label.has_value())
+        {
+            if (m_label.value().compare(label) == 0)
+            {
+                std::cout << YELLOW_BOLD
+                          << bf::LABEL_SEPARATOR
+                          << label
+                          << bf::LABEL_SEPARATOR
+                          << BLUE_BOLD;
+            }
+        }
+        auto m_instr = prog.instr_for_pc(i);
+        if (!m_instr.has_value())
+            break;
+        else
+            std::cout << bf::instr_char(m_instr.value());
+    }
 
-    if (!prog.has_label(label))
+    // Bytes for the reads of the run, non printable ones escaped
+    auto m_input = bf::concretize_input(prog, trace);
+    if (m_input.has_value() && !m_input.value().empty())
+    {
+        std::cout << RESET << std::endl
+                  << "Input: ";
+        for (uint8_t byte : m_input.value())
+        {
+            if (byte >= 0x20 && byte < 0x7f && byte != '\\')
+            {
+                std::cout << (char)byte;
+            }
+            else
+            {
+                const char *digits = "0123456789abcdef";
+                std::cout << "\\x" << digits[byte >> 4] << digits[byte & 0xf];
+            }
+        }
+    }
+};
+
+// Verdicts for many labels from one search, in the order they were given
+auto check_labels = [](bf::Program &prog, const std::vector<std::string> &labels, bf::ReachOptions options)
+{
+    std::vector<bf::LabelVerdict> verdicts;
+    try
+    {
+        verdicts = bf::check_reach_all(prog, labels, options);
+    }
+    catch (bf::ExternalException &ee)
     {
         std::cerr << RED_BOLD;
-        std::cerr
-            << "Label \""
-            << label
-            << "\" does not exist in the specified program."
-            << std::endl;
+        std::cerr << "External search failed: " << ee.what() << std::endl;
         std::cerr << RESET;
-        exit(0);
+        exit(1);
     }
-
-    auto m_run = bf::check_reach(prog, label);
-    if (m_run.has_value())
+    catch (bf::CacheException &ce)
     {
-        auto run = m_run.value();
         std::cerr << RED_BOLD;
-        std::cout
-            << "There exists a run for which the label \""
-            << label
-            << "\" will not be reached:"
-            << std::endl;
-        bf::instr_ptr_t last_ptr = 0;
-        std::cout << BLUE_BOLD;
-        for (auto step : run->prefix)
+        std::cerr << "Cache error: " << ce.what() << std::endl;
+        std::cerr << RESET;
+        exit(1);
+    }
+    for (const auto &verdict : verdicts)
+    {
+        if (verdict.run.has_value())
         {
-            auto ss = static_cast<const bf::KState *>(step.s);
-            auto instr = prog.instr_for_pc(ss->get_instr_ptr());
-            std::cout << bf::instr_char(instr.value());
+            print_run(prog, verdict.label, verdict.run.value());
         }
-        std::cout << RED_BOLD;
-        for (auto step : run->cycle)
+        else if (verdict.bounded)
         {
-            auto ss = static_cast<const bf::KState *>(step.s);
-            auto instr = prog.instr_for_pc(ss->get_instr_ptr());
-            std::cout << bf::instr_char(instr.value());
-            last_ptr = ss->get_instr_ptr();
+            std::cout << YELLOW_BOLD;
+            std::cout
+                << "No run up to depth "
+                << options.max_depth.value()
+                << " misses the label \""
+                << verdict.label
+                << "\".";
         }
-        std::cout << BLUE_BOLD;
-        for (bf::instr_ptr_t i = last_ptr + 1; true; i++)
+        else
         {
-            auto m_label = prog.label_for_instr_ptr(i);
-            if (m_label.has_value())
-            {
-                if (m_label.value().compare(label) == 0)
-                {
-                    std::cout << YELLOW_BOLD
-                              << bf::LABEL_SEPARATOR
-                              << label
-                              << bf::LABEL_SEPARATOR
-                              << BLUE_BOLD;
-                }
-            }
-            auto m_instr = prog.instr_for_pc(i);
-            if (!m_instr.has_value())
-                break;
-            else
-                std::cout << bf::instr_char(m_instr.value());
+            std::cout << GREEN_BOLD;
+            std::cout
+                << "Label \""
+                << verdict.label
+                << "\" will always be reached.";
         }
+        std::cout << RESET << std::endl;
+    }
+};
+
+ap::CheckReachFun crfun = [](std::string filename, std::vector<std::string> labels, bool all_labels, bf::IOModel io_model, bf::ReachOptions options)
+{
+    bf::Program prog = parse_bf_program(filename, bf::MemoryModel(), io_model);
+
+    if (all_labels)
+    {
+        // Every label once, in the order they first appear
+        for (const auto &kv : prog.get_label_map())
+        {
+            if (std::find(labels.begin(), labels.end(), kv.second) == labels.end())
+                labels.push_back(kv.second);
+        }
+        if (labels.empty())
+        {
+            std::cerr << RED_BOLD;
+            std::cerr << "The specified program has no labels." << std::endl;
+            std::cerr << RESET;
+            exit(0);
+        }
+    }
+    for (const std::string &label : labels)
+    {
+        if (!prog.has_label(label))
+        {
+            std::cerr << RED_BOLD;
+            std::cerr
+                << "Label \""
+                << label
+                << "\" does not exist in the specified program."
+                << std::endl;
+            std::cerr << RESET;
+            exit(0);
+        }
+    }
+    if (labels.size() > 1)
+    {
+        check_labels(prog, labels, options);
+        return;
+    }
+
+    const std::string &label = labels.front();
+    bool bounded = false;
+    bf::ApproxReport report;
+    std::optional<spot::twa_run_ptr> m_run;
+    try
+    {
+        m_run = bf::check_reach(prog, label, options, &bounded, &report);
+    }
+    catch (bf::ExternalException &ee)
+    {
+        std::cerr << RED_BOLD;
+        std::cerr << "External search failed: " << ee.what() << std::endl;
+        std::cerr << RESET;
+        exit(1);
+    }
+    catch (bf::CacheException &ce)
+    {
+        std::cerr << RED_BOLD;
+        std::cerr << "Cache error: " << ce.what() << std::endl;
+        std::cerr << RESET;
+        exit(1);
+    }
+    if (m_run.has_value())
+    {
+        print_run(prog, label, m_run.value());
+    }
+    else if (options.approx != bf::ReachApprox::ExactStates)
+    {
+        std::cout << YELLOW_BOLD;
+        std::cout
+            << "Label \""
+            << label
+            << "\" is reached on every run the approximate search explored.";
+    }
+    else if (bounded)
+    {
+        std::cout << YELLOW_BOLD;
+        std::cout
+            << "No run up to depth "
+            << options.max_depth.value()
+            << " misses the label \""
+            << label
+            << "\".";
     }
     else
     {
@@ -136,6 +324,57 @@ ap::CheckReachFun crfun = [](std::string filename, std::string label, bf::IOMode
             << "\" will always be reached.";
     }
     std::cout << RESET << std::endl;
+
+    if (options.approx != bf::ReachApprox::ExactStates)
+    {
+        std::cout << "Visited " << report.states << " states in " << report.memory_bytes << " bytes";
+        if (report.hashes > 0)
+            std::cout << " with " << report.hashes << " hashes per state";
+        std::cout << ", " << report.depth << " deep" << std::endl;
+        if (report.depth_limited)
+        {
+            std::cout << YELLOW_BOLD
+                      << "The search stopped at --max-depth and deeper states were left out."
+                      << RESET << std::endl;
+        }
+        if (report.table_full)
+        {
+            std::cout << YELLOW_BOLD
+                      << "The hash table filled up and later states were dropped, raise --mem-budget."
+                      << RESET << std::endl;
+        }
+        else
+        {
+            std::cout << "Expected coverage: " << report.coverage * 100 << "%, "
+                      << "probability of omitting a state: " << report.omission_probability << std::endl;
+        }
+    }
+};
+
+ap::BatchFun batchfun = [](std::string manifest, unsigned int threads, bf::Engine engine)
+{
+    std::ifstream file(manifest);
+    if (!file.is_open())
+    {
+        std::cerr << RED_BOLD;
+        std::cerr << "Could not open manifest " << manifest << std::endl;
+        std::cerr << RESET;
+        exit(1);
+    }
+
+    std::vector<bf::BatchJob> jobs;
+    try
+    {
+        jobs = bf::parse_manifest(&file);
+    }
+    catch (bf::ParseException &pe)
+    {
+        std::cerr << RED_BOLD;
+        std::cerr << "Parse error: " << pe.what() << std::endl;
+        std::cerr << RESET;
+        exit(1);
+    }
+    bf::run_batch(jobs, threads, engine, std::cout);
 };
 
 int main(int argc, char **argv)
@@ -143,7 +382,9 @@ int main(int argc, char **argv)
     return ap::run_with_args(
         argc, argv,
         exfun,
+        compfun,
         pfun,
         dotfun,
-        crfun);
+        crfun,
+        batchfun);
 }
@@ -1,3 +1,6 @@
+#include <atomic>
+#include <dirent.h>
+#include <unistd.h>
 #include <minunit.h>
 #include <brainfuck.hpp>
 
@@ -94,12 +97,74 @@ MU_TEST(parsing_labels)
     }
 }
 
+MU_TEST(parsing_error_positions)
+{
+    std::string unmatched_close = "+[-]\nab]+";
+    std::istringstream close_source(unmatched_close);
+    try
+    {
+        Program::parse_from_istream(&close_source, MemoryModel(), IOModel());
+        mu_fail("Parsing did NOT fail even though source had an unmatched ]");
+    }
+    catch (ParseException &pe)
+    {
+        mu_check(std::string(pe.what()) == "Unmatched ']' at line 2, column 3");
+    }
+
+    std::string unmatched_open = "[\n+[[-]";
+    std::istringstream open_source(unmatched_open);
+    try
+    {
+        Program::parse_from_istream(&open_source, MemoryModel(), IOModel());
+        mu_fail("Parsing did NOT fail even though source had an unmatched [");
+    }
+    catch (ParseException &pe)
+    {
+        mu_check(std::string(pe.what()) == "Unmatched '[' at line 2, column 2");
+    }
+}
+
+MU_TEST(parsing_comments)
+{
+    // Instructions at every offset within and across vector blocks
+    std::string source;
+    std::string expected;
+    const std::string instructions = "<>+-,.[]";
+    for (size_t i = 0; i < 200; i++)
+    {
+        source += std::string(i % 37, 'x') + "*/ \n\t" + std::string(i % 5, (char)(0x80 | (i & 0x7f)));
+        char c = instructions[i % 6];
+        source.push_back(c);
+        expected.push_back(c);
+    }
+    source += "_a label with spaces_,";
+    expected += ",";
+    for (size_t pos = 0; pos < source.size(); pos++)
+    {
+        size_t next = find_significant(source.data(), pos, source.size());
+        size_t reference = pos;
+        while (reference < source.size() && !is_significant(source[reference]))
+            reference++;
+        mu_check(next == reference);
+    }
+
+    Program prog = Program::parse_from_buffer(source.data(), source.size(), MemoryModel(), IOModel());
+    std::string parsed;
+    for (Instruction instr : prog.get_instructions())
+        parsed.push_back(instr_char(instr));
+    mu_check(parsed == expected);
+    mu_check(prog.has_label("a label with spaces"));
+    mu_check(prog.label_for_instr_ptr(200).value() == "a label with spaces");
+}
+
 MU_TEST_SUITE(parsing)
 {
     MU_RUN_TEST(parsing_ok);
     MU_RUN_TEST(parsing_imbalanced1);
     MU_RUN_TEST(parsing_imbalanced2);
     MU_RUN_TEST(parsing_labels);
+    MU_RUN_TEST(parsing_error_positions);
+    MU_RUN_TEST(parsing_comments);
 }
 
 MU_TEST(memory_model_cell_size_wrapping)
@@ -154,6 +219,25 @@ MU_TEST(memory_model_wrapping)
     mu_check(wrapping_mm.get_pointer() == 0);
 }
 
+MU_TEST(memory_model_paged_tape)
+{
+    MemoryModel paged_mm = MemoryModel(CellSize::SixteenBit, 1UL << 24, true);
+    paged_mm.left();
+    mu_check(paged_mm.get_pointer() == (1UL << 24) - 1);
+    paged_mm.decrement();
+    mu_check(paged_mm.get_current_value() == 65535);
+    mu_check(paged_mm.get_value(0) == 0);
+    mu_check(paged_mm.get_value(1UL << 20) == 0);
+
+    std::string wrapping_copy = "<+++[->>+<<]>>";
+    std::istringstream source(wrapping_copy);
+    Program prog = Program::parse_from_istream(&source, paged_mm, IOModel());
+    prog.run();
+    mu_check(prog.memory_model.get_value((1UL << 24) - 1) == 0);
+    mu_check(prog.memory_model.get_value(1) == 3);
+    mu_check(prog.memory_model.get_pointer() == 1);
+}
+
 MU_TEST(io_model_chars_until_eof)
 {
     IOModel io = IOModel(1);
@@ -174,64 +258,551 @@ MU_TEST_SUITE(models)
 {
     MU_RUN_TEST(memory_model_cell_size_wrapping);
     MU_RUN_TEST(memory_model_wrapping);
+    MU_RUN_TEST(memory_model_paged_tape);
     MU_RUN_TEST(io_model_chars_until_eof);
 }
 
+MU_TEST(bytecode_folding)
+{
+    std::string folded = "+++--+>>><<_label_.";
+    std::istringstream source(folded);
+    Program prog = Program::parse_from_istream(&source, MemoryModel(), IOModel());
+    auto ops = Bytecode::compile(prog).get_ops();
+    mu_check(ops.size() == 4);
+    mu_check(ops[0].code == OpCode::op_add && ops[0].arg == 2);
+    mu_check(ops[1].code == OpCode::op_move && ops[1].arg == 1);
+    mu_check(ops[2].code == OpCode::op_put);
+    mu_check(ops[3].code == OpCode::op_halt);
+
+    std::istringstream clamped_source(folded);
+    MemoryModel non_wrapping_mm = MemoryModel(CellSize::EightBit, 30000, false);
+    Program clamped = Program::parse_from_istream(&clamped_source, non_wrapping_mm, IOModel());
+    auto clamped_ops = Bytecode::compile(clamped).get_ops();
+    mu_check(clamped_ops.size() == 5);
+    mu_check(clamped_ops[1].code == OpCode::op_move && clamped_ops[1].arg == 3);
+    mu_check(clamped_ops[2].code == OpCode::op_move && clamped_ops[2].arg == -2);
+}
+
+MU_TEST(bytecode_loops)
+{
+    std::string loops = "[-]++++[->++>+++<<]>>[-<]";
+    std::istringstream source(loops);
+    Program prog = Program::parse_from_istream(&source, MemoryModel(), IOModel());
+    auto ops = Bytecode::compile(prog).get_ops();
+    mu_check(ops[0].code == OpCode::op_set && ops[0].arg == 4);
+    mu_check(ops[1].code == OpCode::op_mul && ops[1].offset == 1 && ops[1].arg == 2);
+    mu_check(ops[2].code == OpCode::op_mul && ops[2].offset == 2 && ops[2].arg == 3);
+    mu_check(ops[3].code == OpCode::op_set && ops[3].arg == 0);
+    mu_check(ops[5].code == OpCode::op_jz && ops[5].arg == 9);
+    mu_check(ops[8].code == OpCode::op_jnz && ops[8].arg == 6);
+
+    prog.run();
+    mu_check(prog.memory_model.get_value(0) == 0);
+    mu_check(prog.memory_model.get_value(1) == 7);
+    mu_check(prog.memory_model.get_value(2) == 11);
+    mu_check(prog.memory_model.get_pointer() == 0);
+}
+
+MU_TEST(bytecode_counting_up)
+{
+    std::string loop = "-[+>+<]>[->+>+++<<]";
+    std::istringstream source(loop);
+    Program prog = Program::parse_from_istream(&source, MemoryModel(CellSize::SixteenBit), IOModel());
+    prog.run();
+    mu_check(prog.memory_model.get_value(0) == 0);
+    mu_check(prog.memory_model.get_value(1) == 0);
+    mu_check(prog.memory_model.get_value(2) == 1);
+    mu_check(prog.memory_model.get_value(3) == 3);
+
+    // The product of a wide cell and a large factor doesn't fit an int
+    std::string wide = "-[->" + std::string(40000, '+') + "<]";
+    for (Engine engine : {Engine::SwitchDispatch, Engine::ThreadedDispatch})
+    {
+        std::istringstream wide_source(wide);
+        Program wide_prog = Program::parse_from_istream(&wide_source, MemoryModel(CellSize::SixteenBit, 8, true), IOModel());
+        wide_prog.run(engine);
+        mu_check(wide_prog.memory_model.get_value(0) == 0);
+        mu_check(wide_prog.memory_model.get_value(1) == (65536 - 40000) % 65536);
+    }
+}
+
+MU_TEST(bytecode_engines_agree)
+{
+    std::string nested = "++++++[>++++[>+>++<<-]>[>>+<<-]<<-]>>>[<+>>+<-]<<<<-[+>+<]";
+    for (Engine engine : {Engine::SwitchDispatch, Engine::ThreadedDispatch, Engine::Jit})
+    {
+        std::istringstream source(nested);
+        Program prog = Program::parse_from_istream(&source, MemoryModel(CellSize::EightBit, 8, true), IOModel());
+        prog.run(engine);
+        mu_check(prog.memory_model.get_value(0) == 1);
+        mu_check(prog.memory_model.get_value(1) == 0);
+        mu_check(prog.memory_model.get_value(2) == 48);
+        mu_check(prog.memory_model.get_value(3) == 0);
+        mu_check(prog.memory_model.get_value(4) == 72);
+        mu_check(prog.memory_model.get_value(7) == 0);
+        mu_check(prog.memory_model.get_pointer() == 7);
+    }
+}
+
+MU_TEST(bytecode_scan_loops)
+{
+    std::string scan = ">+>+>+>+<<<[>]";
+    std::istringstream source(scan);
+    Program prog = Program::parse_from_istream(&source, MemoryModel(), IOModel());
+    auto ops = Bytecode::compile(prog).get_ops();
+    mu_check(ops[ops.size() - 2].code == OpCode::op_scan && ops[ops.size() - 2].arg == 1);
+
+    std::map<std::string, mem_ptr_t> wrapping_scans{
+        std::make_pair(">+>+>+>+<<<[>]", 5),
+        std::make_pair("+>>>+>>>+[>>>]", 1),
+        std::make_pair("++>+>>+[<<]", 7),
+        std::make_pair("+>+>+>+>+>+>+<<[<]", 7)};
+    for (const auto &kv : wrapping_scans)
+    {
+        for (Engine engine : {Engine::SwitchDispatch, Engine::ThreadedDispatch, Engine::Jit})
+        {
+            std::istringstream wrapping_source(kv.first);
+            Program wrapping = Program::parse_from_istream(&wrapping_source, MemoryModel(CellSize::EightBit, 8, true), IOModel());
+            wrapping.run(engine);
+            mu_check(wrapping.memory_model.get_pointer() == kv.second);
+        }
+    }
+}
+
+MU_TEST(bytecode_io)
+{
+    // More input than fits into one buffer, with whitespace kept intact
+    std::string input = "hello, world\n\t";
+    while (input.size() < 3 * IO_BUFFER_SIZE)
+        input += input;
+    for (Engine engine : {Engine::SwitchDispatch, Engine::ThreadedDispatch, Engine::Jit})
+    {
+        std::istringstream source(",[.,]");
+        Program echo = Program::parse_from_istream(&source, MemoryModel(), IOModel());
+        MemorySource in(input);
+        MemorySink out;
+        echo.run(in, out, engine);
+        mu_check(out.get_data() == input);
+
+        std::istringstream eof_source("+,.,.");
+        IOModel eof_io = IOModel();
+        eof_io.set_eof_char(7);
+        Program eof_char = Program::parse_from_istream(&eof_source, MemoryModel(), eof_io);
+        MemorySource eof_in("a");
+        MemorySink eof_out;
+        eof_char.run(eof_in, eof_out, engine);
+        mu_check(eof_out.get_data() == "a\x07");
+
+        std::istringstream no_change_source("+,.,.");
+        IOModel no_change_io = IOModel();
+        no_change_io.set_no_change_on_eof(true);
+        Program no_change = Program::parse_from_istream(&no_change_source, MemoryModel(), no_change_io);
+        MemorySource no_change_in("");
+        MemorySink no_change_out;
+        no_change.run(no_change_in, no_change_out, engine);
+        mu_check(no_change_out.get_data() == std::string("\x01\x01"));
+    }
+}
+
+MU_TEST(bytecode_generate_c)
+{
+    std::istringstream source(",[->+<]>[.<<]");
+    IOModel io_model = IOModel();
+    io_model.set_eof_char(4);
+    Program prog = Program::parse_from_istream(&source, MemoryModel(CellSize::SixteenBit, 100, false), io_model);
+    std::string c = generate_c(prog);
+    mu_check(c.find("typedef uint16_t cell_t;") != std::string::npos);
+    mu_check(c.find("#define MEMORY_SIZE ((size_t)100u)") != std::string::npos);
+    mu_check(c.find("tape[ptr] = in >= 0 ? (cell_t)in : 4u;") != std::string::npos);
+    // Without wrapping the multiplication loop stays a loop and moves clamp
+    mu_check(c.find("while (tape[ptr] != 0)") != std::string::npos);
+    mu_check(c.find("ptr = ptr > 2u ? ptr - 2u : 0;") != std::string::npos);
+    mu_check(c.find("scan_right") == std::string::npos);
+
+    // The built program has to behave like the interpreter, with wrapping
+    // so that the loops turn into multiplications, clears and scans
+    std::string program = ",>,<[->+++>+<<]>[-<+>]<.>>.[-]<<[>>>+<<<-]>>>>+[<]<.,.";
+    std::string input = "\x05\x02";
+    IOModel eof_io = IOModel();
+    eof_io.set_eof_char(9);
+    std::istringstream interpreted_source(program);
+    Program interpreted = Program::parse_from_istream(&interpreted_source, MemoryModel(CellSize::EightBit, 16, true), eof_io);
+    MemorySource in(input);
+    MemorySink out;
+    interpreted.run(in, out);
+
+    std::istringstream native_source(program);
+    Program native = Program::parse_from_istream(&native_source, MemoryModel(CellSize::EightBit, 16, true), eof_io);
+    char binary_path[] = "/tmp/braincheck-testXXXXXX";
+    int fd = mkstemp(binary_path);
+    mu_check(fd >= 0);
+    close(fd);
+    char input_path[] = "/tmp/braincheck-testXXXXXX";
+    fd = mkstemp(input_path);
+    mu_check(fd >= 0);
+    mu_check(write(fd, input.data(), input.size()) == (ssize_t)input.size());
+    close(fd);
+    compile_native(native, binary_path, "cc");
+    std::string command = std::string(binary_path) + " < " + input_path;
+    FILE *pipe = popen(command.c_str(), "r");
+    mu_check(pipe != nullptr);
+    std::string output;
+    char buffer[256];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+        output.append(buffer, n);
+    mu_check(pclose(pipe) == 0);
+    unlink(binary_path);
+    unlink(input_path);
+    mu_check(output == out.get_data());
+    mu_check(output == std::string("\x11\x05\x00\x09", 4));
+}
+
+MU_TEST(bytecode_profile)
+{
+    std::istringstream source("++[>+++[>+<-]<-]>>.[-]");
+    Program prog = Program::parse_from_istream(&source, MemoryModel(), IOModel());
+    MemorySource in("");
+    MemorySink out;
+    Profile profile = run_profiled(prog, in, out);
+    mu_check(out.get_data() == "\x06");
+    mu_check(prog.memory_model.get_value(1) == 0 && prog.memory_model.get_value(2) == 0);
+    mu_check(profile.high_water == 2);
+    mu_check(profile.hits[0] == 1 && profile.hits[2] == 1 && profile.hits[3] == 2);
+
+    mu_check(profile.loops.size() == 3);
+    const LoopProfile &outer = profile.loops[0];
+    const LoopProfile &inner = profile.loops[1];
+    const LoopProfile &clear = profile.loops[2];
+    mu_check(outer.open == 2 && outer.close == 15);
+    mu_check(outer.entries == 1 && outer.iterations == 2 && outer.histogram[2] == 1);
+    mu_check(inner.entries == 2 && inner.iterations == 6 && inner.histogram[2] == 2);
+    mu_check(clear.entries == 1 && clear.iterations == 6 && clear.histogram[3] == 1);
+    mu_check(outer.instructions == profile.steps - 2 - 2 - 1 - clear.instructions);
+
+    std::ostringstream json;
+    profile.write_json(json);
+    mu_check(json.str().find("{\"open\":2,\"close\":15,\"entries\":1,\"iterations\":2,") != std::string::npos);
+    std::ostringstream report;
+    profile.print_report(report, prog);
+    mu_check(report.str().find("pc 2-15") != std::string::npos);
+}
+
+MU_TEST_SUITE(bytecode)
+{
+    MU_RUN_TEST(bytecode_folding);
+    MU_RUN_TEST(bytecode_loops);
+    MU_RUN_TEST(bytecode_counting_up);
+    MU_RUN_TEST(bytecode_engines_agree);
+    MU_RUN_TEST(bytecode_scan_loops);
+    MU_RUN_TEST(bytecode_io);
+    MU_RUN_TEST(bytecode_generate_c);
+    MU_RUN_TEST(bytecode_profile);
+}
+
+// Interns a state into the store the way the Kripke structure would
+static KState make_state(StateStore &store, instr_ptr_t pc, mem_ptr_t mem_ptr,
+                         const std::map<mem_ptr_t, uint8_t> &memory,
+                         std::optional<unsigned int> remaining = std::nullopt)
+{
+    tape_id_t tape = StateStore::EMPTY_TAPE;
+    for (const auto &kv : memory)
+        tape = store.set_cell(tape, kv.first, kv.second);
+    return KState(&store, store.intern(StateHeader{pc, mem_ptr, remaining}, tape));
+}
+
 MU_TEST(KState_hashing_basics)
 {
+    StateStore store(30000);
     std::map<mem_ptr_t, uint8_t> empty_memory{};
     std::map<mem_ptr_t, uint8_t> memory1{std::make_pair(0, 1)};
     std::map<mem_ptr_t, uint8_t> memory2{std::make_pair(0, 1), std::make_pair(1, 2)};
     std::map<mem_ptr_t, uint8_t> memory3{std::make_pair(1, 2), std::make_pair(0, 1), std::make_pair(3, 0)};
     std::map<mem_ptr_t, uint8_t> memory4{std::make_pair(0, 0), std::make_pair(1, 0)};
     std::map<mem_ptr_t, uint8_t> memory5{std::make_pair(1, 1)};
+    KState initial = make_state(store, 0, 0, empty_memory);
     mu_check(
-        KState(0, 0, empty_memory).hash() ==
-        KState().hash());
+        make_state(store, 0, 0, empty_memory).hash() ==
+        initial.hash());
     mu_check(
-        KState(0, 0, empty_memory, std::nullopt).hash() ==
-        KState().hash());
+        make_state(store, 0, 0, empty_memory, std::nullopt).hash() ==
+        initial.hash());
     mu_check(
-        KState(0, 0, empty_memory).hash() ==
-        KState(0, 0, empty_memory).hash());
+        make_state(store, 0, 0, empty_memory).hash() ==
+        make_state(store, 0, 0, empty_memory).hash());
     mu_check(
-        KState(1, 0, empty_memory).hash() !=
-        KState(0, 0, empty_memory).hash());
+        make_state(store, 1, 0, empty_memory).hash() !=
+        make_state(store, 0, 0, empty_memory).hash());
     mu_check(
-        KState(0, 1, empty_memory).hash() !=
-        KState(0, 0, empty_memory).hash());
+        make_state(store, 0, 1, empty_memory).hash() !=
+        make_state(store, 0, 0, empty_memory).hash());
     mu_check(
-        KState(1, 0, empty_memory).hash() !=
-        KState(0, 1, empty_memory).hash());
+        make_state(store, 1, 0, empty_memory).hash() !=
+        make_state(store, 0, 1, empty_memory).hash());
     mu_check(
-        KState(0, 0, memory1).hash() ==
-        KState(0, 0, memory1).hash());
+        make_state(store, 0, 0, memory1).hash() ==
+        make_state(store, 0, 0, memory1).hash());
     mu_check(
-        KState(0, 0, empty_memory).hash() !=
-        KState(0, 0, memory1).hash());
+        make_state(store, 0, 0, empty_memory).hash() !=
+        make_state(store, 0, 0, memory1).hash());
     mu_check(
-        KState(0, 0, memory1).hash() !=
-        KState(0, 0, memory2).hash());
+        make_state(store, 0, 0, memory1).hash() !=
+        make_state(store, 0, 0, memory2).hash());
     mu_check(
-        KState(0, 0, memory2).hash() ==
-        KState(0, 0, memory3).hash());
+        make_state(store, 0, 0, memory2).hash() ==
+        make_state(store, 0, 0, memory3).hash());
     mu_check(
-        KState(0, 0, empty_memory).hash() ==
-        KState(0, 0, memory4).hash());
+        make_state(store, 0, 0, empty_memory).hash() ==
+        make_state(store, 0, 0, memory4).hash());
     mu_check(
-        KState(0, 0, memory1).hash() !=
-        KState(0, 0, memory5).hash());
+        make_state(store, 0, 0, memory1).hash() !=
+        make_state(store, 0, 0, memory5).hash());
     mu_check(
-        KState(0, 0, empty_memory, std::make_optional(1)).hash() !=
-        KState().hash());
+        make_state(store, 0, 0, empty_memory, std::make_optional(1)).hash() !=
+        initial.hash());
     mu_check(
-        KState(0, 0, empty_memory, std::make_optional(1)).hash() !=
-        KState(0, 0, empty_memory, std::make_optional(2)).hash());
+        make_state(store, 0, 0, empty_memory, std::make_optional(1)).hash() !=
+        make_state(store, 0, 0, empty_memory, std::make_optional(2)).hash());
+}
+
+MU_TEST(state_store_interning)
+{
+    StateStore store(30000);
+    tape_id_t tape = store.set_cell(store.set_cell(StateStore::EMPTY_TAPE, 5, 1), 29999, 2);
+    mu_check(store.get_cell(tape, 5) == 1);
+    mu_check(store.get_cell(tape, 29999) == 2);
+    mu_check(store.get_cell(tape, 6) == 0);
+    mu_check(store.get_cell(StateStore::EMPTY_TAPE, 5) == 0);
+
+    // Equal tapes are the same id however they were built, and clearing
+    // every cell goes back to the empty tape
+    tape_id_t changed = store.set_cell(tape, 5, 3);
+    mu_check(changed != tape);
+    mu_check(store.get_cell(tape, 5) == 1);
+    mu_check(store.set_cell(changed, 5, 1) == tape);
+    mu_check(store.set_cell(store.set_cell(StateStore::EMPTY_TAPE, 29999, 2), 5, 1) == tape);
+    mu_check(store.set_cell(store.set_cell(tape, 29999, 0), 5, 0) == StateStore::EMPTY_TAPE);
+
+    // States are dense ids, equal when their contents are
+    size_t before = store.state_count();
+    state_id_t a = store.intern(StateHeader{1, 5, std::nullopt}, tape);
+    state_id_t b = store.intern(StateHeader{1, 5, std::make_optional(0U)}, tape);
+    mu_check(a != b);
+    mu_check(store.intern(StateHeader{1, 5, std::nullopt}, store.set_cell(changed, 5, 1)) == a);
+    mu_check(store.state_count() == before + 2);
+    mu_check(store.get_header(b).remaining_stdin_chars == std::make_optional(0U));
+    mu_check(store.get_tape(a) == tape);
+
+    KState state(&store, a);
+    KState *copy = state.clone();
+    mu_check(copy->compare(&state) == 0);
+    mu_check(copy->get_cell(5) == 1);
+    mu_check(copy->get_instr_ptr() == 1 && copy->get_mem_ptr() == 5);
+    mu_check(KState(&store, b).compare(&state) != 0);
+    copy->destroy();
+}
+
+MU_TEST(shared_state_store)
+{
+    // Packed states hold nothing that belongs to the store they came from
+    StateStore store(30000);
+    tape_id_t tape = store.set_cell(store.set_cell(StateStore::EMPTY_TAPE, 29999, 2), 5, 1);
+    StateHeader header{3, 5, std::make_optional(1U)};
+    header.abstract_cells = store.intern_cells(AbstractCells{AbstractCell{7, store.intern_values(ValueSet{6, 0, 0, 0})}});
+    PackedState packed = store.pack(store.intern(header, tape));
+    mu_check((packed.cells == std::vector<std::pair<mem_ptr_t, uint8_t>>{{5, 1}, {29999, 2}}));
+    mu_check(packed.abstract_cells.size() == 1 && packed.abstract_cells[0].first == 7);
+    mu_check(packed.header.abstract_cells == 0);
+    StateStore other(30000);
+    other.set_cell(StateStore::EMPTY_TAPE, 1, 1);
+    mu_check(other.pack(other.unpack(packed)) == packed);
+
+    // Threads interning the same states at once get the same ids, and
+    // states that differ only in their header share one tape
+    SharedStateStore shared(30000);
+    std::vector<shared_state_id_t> ids(256);
+    WorkStealingPool pool(4);
+    pool.run(ids.size(), [&](size_t i)
+             {
+                 PackedState state = packed;
+                 state.header.pc = i % 64;
+                 ids[i] = shared.unpack(state); });
+    mu_check(shared.state_count() == 64);
+    for (size_t i = 0; i < ids.size(); i++)
+        mu_check(ids[i] == ids[i % 64] && shared.get_tape(ids[i]) == shared.get_tape(ids[0]));
+    mu_check(shared.pack(ids[3]).header.pc == 3);
+    mu_check(shared.pack(ids[3]).cells == packed.cells);
+
+    // Tapes built on many threads from many pages at once come out whole
+    std::vector<tape_id_t> tapes(64);
+    pool.run(tapes.size(), [&](size_t i)
+             {
+                 tape_id_t tape = SharedStateStore::EMPTY_TAPE;
+                 for (mem_ptr_t ptr = 0; ptr < 30000; ptr += 61)
+                     tape = shared.set_cell(tape, ptr, (uint8_t)(ptr + i % 8));
+                 tapes[i] = tape; });
+    for (size_t i = 0; i < tapes.size(); i++)
+    {
+        mu_check(tapes[i] == tapes[i % 8]);
+        mu_check(shared.get_cell(tapes[i], 61 * 100) == (uint8_t)(61 * 100 + i % 8));
+    }
+}
+
+MU_TEST(visited_set)
+{
+    VisitedSet visited;
+    visited.reserve(5000);
+    std::vector<uint8_t> added(10000, 0);
+    WorkStealingPool pool(4);
+    pool.run(added.size(), [&](size_t i)
+             { added[i] = visited.insert(i % 5000 + 1); });
+    size_t count = 0;
+    for (uint8_t a : added)
+        count += a;
+    mu_check(count == 5000);
+    mu_check(visited.size() == 5000);
+    mu_check(visited.contains(1) && !visited.contains(5001));
+
+    // Indices survive making room
+    visited.set_index(42, 7);
+    visited.reserve(100000);
+    mu_check(visited.get_index(42) == 7);
+    mu_check(visited.contains(5000));
+}
+
+MU_TEST(approx_visited_set)
+{
+    auto state = [](unsigned int i)
+    {
+        PackedState packed;
+        packed.header = StateHeader{i % 7, i / 7, std::nullopt};
+        packed.cells.push_back(std::make_pair(i % 5, (uint8_t)(i + 1)));
+        return packed;
+    };
+
+    // Plenty of room makes collisions all but impossible
+    for (ReachApprox approx : {ReachApprox::BitstateHashing, ReachApprox::HashCompaction})
+    {
+        ApproxVisitedSet visited(approx, 1 << 20);
+        size_t added = 0;
+        for (unsigned int i = 0; i < 1000; i++)
+            added += visited.insert(state(i));
+        mu_check(added == 1000);
+        mu_check(!visited.insert(state(500)));
+        ApproxReport report;
+        visited.fill_report(report);
+        mu_check(report.states == 1000 && !report.table_full);
+        mu_check(report.coverage > 0.999 && report.omission_probability < 0.001);
+    }
+
+    // Eight slots hold seven fingerprints before the table counts as full
+    ApproxVisitedSet small(ReachApprox::HashCompaction, 64);
+    for (unsigned int i = 0; i < 20; i++)
+        small.insert(state(i));
+    ApproxReport report;
+    small.fill_report(report);
+    mu_check(report.states == 7 && report.table_full);
+    mu_check(report.memory_bytes == 64);
 }
 
 MU_TEST_SUITE(hashing)
 {
     MU_RUN_TEST(KState_hashing_basics);
+    MU_RUN_TEST(state_store_interning);
+    MU_RUN_TEST(shared_state_store);
+    MU_RUN_TEST(visited_set);
+    MU_RUN_TEST(approx_visited_set);
+}
+
+MU_TEST(batch_pool)
+{
+    std::vector<std::atomic<int>> runs(1000);
+    WorkStealingPool pool(4);
+    pool.run(runs.size(), [&](size_t i)
+             { runs[i]++; });
+    for (const auto &count : runs)
+        mu_check(count == 1);
+    pool.run(0, [&](size_t)
+             { mu_fail("Pool ran a task that does not exist"); });
+}
+
+MU_TEST(batch_manifest)
+{
+    std::istringstream manifest(
+        "# comment\n"
+        "\n"
+        "execute hello.bf\n"
+        "execute echo.bf input.txt --eof-char 4\n"
+        "check_reach prog.bf end --max-stdin-length 2 --no-change-on-eof\n");
+    auto jobs = parse_manifest(&manifest);
+    mu_check(jobs.size() == 3);
+    mu_check(jobs[0].command == BatchCommand::BatchExecute && jobs[0].argument.empty());
+    mu_check(jobs[1].argument == "input.txt" && jobs[1].io_model.get_eof_char() == 4);
+    mu_check(jobs[2].command == BatchCommand::BatchCheckReach && jobs[2].argument == "end");
+    mu_check(jobs[2].io_model.get_chars_until_eof().value() == 2);
+    mu_check(jobs[2].io_model.get_no_change_on_eof());
+
+    for (std::string bad : {"run prog.bf", "check_reach prog.bf", "execute prog.bf --eof-char", "execute a.bf b c"})
+    {
+        std::istringstream bad_manifest(bad);
+        try
+        {
+            parse_manifest(&bad_manifest);
+            mu_fail("Parsing did NOT fail even though the manifest was invalid.");
+        }
+        catch (ParseException &pe)
+        {
+            mu_check(std::string(pe.what()).find("Manifest line 1") == 0);
+        }
+    }
+}
+
+MU_TEST(batch_execute)
+{
+    char program_path[] = "/tmp/braincheck-testXXXXXX";
+    int fd = mkstemp(program_path);
+    mu_check(fd >= 0);
+    std::string echo = ",[.,]";
+    mu_check(write(fd, echo.data(), echo.size()) == (ssize_t)echo.size());
+    close(fd);
+    char input_path[] = "/tmp/braincheck-testXXXXXX";
+    fd = mkstemp(input_path);
+    mu_check(fd >= 0);
+    std::string input = "\"quoted\"\n";
+    mu_check(write(fd, input.data(), input.size()) == (ssize_t)input.size());
+    close(fd);
+
+    std::vector<BatchJob> jobs;
+    for (int i = 0; i < 8; i++)
+        jobs.push_back(BatchJob{BatchCommand::BatchExecute, program_path, input_path, IOModel()});
+    jobs.push_back(BatchJob{BatchCommand::BatchExecute, "/nonexistent.bf", "", IOModel()});
+    std::ostringstream out;
+    run_batch(jobs, 3, Engine::ThreadedDispatch, out);
+    unlink(program_path);
+    unlink(input_path);
+
+    std::istringstream lines(out.str());
+    std::string line;
+    size_t count = 0, outputs = 0, errors = 0;
+    while (std::getline(lines, line))
+    {
+        count++;
+        if (line.find("\"output\":\"\\\"quoted\\\"\\n\"") != std::string::npos)
+            outputs++;
+        if (line.find("\"error\":\"Could not open file\"") != std::string::npos)
+            errors++;
+    }
+    mu_check(count == 9);
+    mu_check(outputs == 8);
+    mu_check(errors == 1);
+    mu_check(json_escape("a\x01\xff") == "a\\u0001\\u00ff");
+}
+
+MU_TEST_SUITE(batch)
+{
+    MU_RUN_TEST(batch_pool);
+    MU_RUN_TEST(batch_manifest);
+    MU_RUN_TEST(batch_execute);
 }
 
 MU_TEST(check_reach_ok)
@@ -303,18 +874,564 @@ MU_TEST(check_reach_limited_input)
     }
 }
 
+// Number of successors on every level of a breadth-first walk. A state
+// that is its own successor, like the end of the program, counts but isn't
+// walked again.
+static std::vector<size_t> kripke_widths(const std::string &program, IOModel io_model, bool abstract_input = false)
+{
+    std::istringstream source(program);
+    Program prog = Program::parse_from_istream(&source, MemoryModel(), io_model);
+    auto k = std::make_shared<Kripke>(prog, spot::make_bdd_dict(), abstract_input);
+
+    std::vector<const spot::state *> frontier{k->get_init_state()};
+    std::vector<size_t> widths;
+    while (!frontier.empty())
+    {
+        std::vector<const spot::state *> next;
+        size_t width = 0;
+        for (const spot::state *s : frontier)
+        {
+            auto it = k->succ_iter(s);
+            for (it->first(); !it->done(); it->next())
+            {
+                const spot::state *dst = it->dst();
+                width++;
+                if (dst->compare(s) == 0)
+                    dst->destroy();
+                else
+                    next.push_back(dst);
+            }
+            k->release_iter(it);
+            s->destroy();
+        }
+        widths.push_back(width);
+        frontier.swap(next);
+    }
+    return widths;
+}
+
+MU_TEST(kripke_successors)
+{
+    // One character of input, then every read sees EOF, and the final . is
+    // part of the transition out of the last read. Nothing looks at the
+    // first byte before it is read over, so one of them is enough. The
+    // end then stays where it is.
+    mu_check((kripke_widths(",_read_,.", IOModel(1)) == std::vector<size_t>{1, 1, 1}));
+}
+
+MU_TEST(input_classes)
+{
+    // Only 0 and 4 can be told apart from the rest
+    std::istringstream source(",----[++++[]]");
+    Program prog = Program::parse_from_istream(&source, MemoryModel(), IOModel());
+    InputClasses classes(prog);
+    mu_check((classes.get_representatives(0) == std::vector<uint8_t>{0, 1, 4}));
+    mu_check(kripke_widths(",----[++++[]]", IOModel(1)).front() == 3);
+
+    // Counting the read cell down tests it against every byte
+    std::istringstream moved(",[->+<]>[-]");
+    prog = Program::parse_from_istream(&moved, MemoryModel(), IOModel());
+    mu_check(InputClasses(prog).get_representatives(0).size() == 256);
+}
+
+MU_TEST(kripke_chains)
+{
+    // Only the start, the jump back into the loop and the label get states
+    mu_check((kripke_widths("++[->+<]>_end_", IOModel()) == std::vector<size_t>{1, 1, 1}));
+
+    // Counterexamples still list every instruction
+    std::istringstream source("+[,]_end_.");
+    Program prog = Program::parse_from_istream(&source, MemoryModel(), IOModel());
+    auto m_run = check_reach(prog, "end");
+    mu_check(m_run.has_value());
+    RunTrace trace = expand_run(m_run.value());
+    mu_check(!trace.cycle.empty());
+    std::string executed = run_trace(prog, m_run.value());
+    mu_check(executed.rfind("+[,]", 0) == 0);
+    mu_check(executed.size() == trace.prefix.size() + trace.cycle.size());
+}
+
+MU_TEST(check_reach_abstract_input)
+{
+    // Every read is a single successor holding all 256 values
+    mu_check((kripke_widths(",>,>,", IOModel(), true) == std::vector<size_t>{1, 1, 1, 1}));
+
+    ReachOptions options;
+    options.abstract_input = true;
+    std::istringstream unbounded("+[,]_end_.");
+    Program prog = Program::parse_from_istream(&unbounded, MemoryModel(), IOModel());
+    mu_check(check_reach(prog, "end", options).has_value());
+    std::istringstream bounded("+[,]_end_.");
+    prog = Program::parse_from_istream(&bounded, MemoryModel(), IOModel(5));
+    mu_check(!check_reach(prog, "end", options).has_value());
+
+    // Only a first byte other than 0 and 4 gets stuck in the inner loop
+    std::istringstream stuck(",----[++++[]]_end_");
+    prog = Program::parse_from_istream(&stuck, MemoryModel(), IOModel());
+    auto m_run = check_reach(prog, "end", options);
+    mu_check(m_run.has_value());
+    auto input = concretize_input(prog, expand_run(m_run.value()));
+    mu_check(input.has_value() && input.value().size() == 1);
+    mu_check(input.value()[0] != 0 && input.value()[0] != 4);
+}
+
+MU_TEST(check_reach_ended_runs)
+{
+    // The end of a program stays where it is, so Spot takes a run that
+    // ends without the label as a counterexample like the search does
+    ReachOptions spot;
+    spot.checker = ReachChecker::SpotEmptiness;
+    spot.static_analysis = false;
+    ReachOptions bfs;
+    bfs.static_analysis = false;
+    std::istringstream skips("+[-]>[_end_]");
+    Program prog = Program::parse_from_istream(&skips, MemoryModel(), IOModel());
+    auto m_run = check_reach(prog, "end", spot);
+    mu_check(m_run.has_value());
+    mu_check(expand_run(m_run.value()).cycle.empty());
+    mu_check(check_reach(prog, "end", bfs).has_value());
+
+    // Only a first byte of 0 ends before the label
+    std::istringstream reads(",[_end_]");
+    prog = Program::parse_from_istream(&reads, MemoryModel(), IOModel(1));
+    m_run = check_reach(prog, "end", spot);
+    mu_check(m_run.has_value());
+    auto input = concretize_input(prog, expand_run(m_run.value()));
+    mu_check(input.has_value() && input.value() == std::vector<uint8_t>{0});
+
+    // Ending after the label is no counterexample
+    std::istringstream after("+_end_");
+    prog = Program::parse_from_istream(&after, MemoryModel(), IOModel());
+    mu_check(!check_reach(prog, "end", spot).has_value());
+    mu_check(!check_reach(prog, "end", bfs).has_value());
+}
+
+MU_TEST(check_reach_threads)
+{
+    // Each checker decides, even where the program alone would
+    ReachOptions spot;
+    spot.checker = ReachChecker::SpotEmptiness;
+    spot.static_analysis = false;
+    ReachOptions spot_threads = spot;
+    spot_threads.threads = 4;
+    ReachOptions bfs_threads;
+    bfs_threads.threads = 4;
+    bfs_threads.static_analysis = false;
+    for (const auto &program : {"+++++[->+++++[->+++++<]<]>>[-]_end_.", "+[,]_end_.", ",----[++++[]]_end_",
+                                ",[_end_]", "+[[-]+]_end_"})
+    {
+        for (IOModel io_model : {IOModel(), IOModel(2)})
+        {
+            std::istringstream source(program);
+            Program prog = Program::parse_from_istream(&source, MemoryModel(), io_model);
+            auto sequential = check_reach(prog, "end", spot);
+            auto parallel = check_reach(prog, "end", spot_threads);
+            mu_check(sequential.has_value() == parallel.has_value());
+            if (sequential.has_value() && parallel.has_value())
+                mu_check(run_trace(prog, sequential.value()) == run_trace(prog, parallel.value()));
+
+            // The breadth-first search agrees, and finds runs just as short
+            // on any number of threads
+            auto bfs = check_reach(prog, "end");
+            auto bfs_parallel = check_reach(prog, "end", bfs_threads);
+            mu_check(bfs.has_value() == sequential.has_value());
+            mu_check(bfs_parallel.has_value() == sequential.has_value());
+            if (bfs.has_value() && bfs_parallel.has_value())
+            {
+                auto &run = bfs.value();
+                auto &other = bfs_parallel.value();
+                mu_check(run->prefix.size() + run->cycle.size() == other->prefix.size() + other->cycle.size());
+            }
+        }
+    }
+}
+
+MU_TEST(check_reach_breadth_first)
+{
+    // A run that ends without the label is the shortest there is here
+    std::istringstream ends(",[_end_]");
+    Program prog = Program::parse_from_istream(&ends, MemoryModel(), IOModel());
+    auto m_run = check_reach(prog, "end");
+    mu_check(m_run.has_value());
+    RunTrace trace = expand_run(m_run.value());
+    mu_check(trace.cycle.empty());
+    mu_check(run_trace(prog, m_run.value()) == ",[");
+    auto input = concretize_input(prog, trace);
+    mu_check(input.has_value() && input.value() == std::vector<uint8_t>{0});
+
+    std::istringstream loops("+[]_end_");
+    prog = Program::parse_from_istream(&loops, MemoryModel(), IOModel());
+    m_run = check_reach(prog, "end");
+    mu_check(m_run.has_value());
+    mu_check(run_trace(prog, m_run.value()) == "+[]]");
+
+    // Reads at EOF go around a cycle of two states three levels down, and
+    // the first state that loops to itself is five levels down
+    std::istringstream around("-[,+_x_]_x_-,+[[]]_end_");
+    prog = Program::parse_from_istream(&around, MemoryModel(), IOModel(1));
+    auto m_lasso = bfs_reach(prog, "end", false, ReachOptions());
+    mu_check(m_lasso.has_value());
+    mu_check(m_lasso.value().prefix.size() == 2 && m_lasso.value().cycle.size() == 2);
+
+    // Moving the value on goes around the whole tape, one cycle through
+    // every state but the first
+    std::istringstream long_cycle("+[[->+<]>]_a_");
+    prog = Program::parse_from_istream(&long_cycle, MemoryModel(), IOModel());
+    m_lasso = bfs_reach(prog, "a", false, ReachOptions());
+    mu_check(m_lasso.has_value());
+    mu_check(m_lasso.value().prefix.size() == 1 && m_lasso.value().cycle.size() == 30000);
+
+    // Nothing gets past a label at the start
+    std::istringstream start("_end_+[]");
+    prog = Program::parse_from_istream(&start, MemoryModel(), IOModel());
+    mu_check(!check_reach(prog, "end").has_value());
+}
+
+MU_TEST(check_reach_wide_tape)
+{
+    // Every state has another cell set across the whole tape, which only
+    // fits when the states share the pages of their tapes
+    std::istringstream wide("+[>[-]+]_a_");
+    Program prog = Program::parse_from_istream(&wide, MemoryModel(), IOModel());
+    ReachOptions options;
+    options.threads = 4;
+    StateSpace space = bfs_explore(prog, false, options);
+    mu_check(space.complete);
+    mu_check(space.successors.size() == 59999);
+
+    options.max_depth = 2000;
+    bool bounded = false;
+    mu_check(!bfs_reach(prog, "a", false, options, &bounded).has_value());
+    mu_check(bounded);
+}
+
+MU_TEST(check_reach_max_depth)
+{
+    // Moving right never ends for most inputs, so only deepening finds the
+    // read loop behind them
+    std::istringstream endless(",[-[>+],[,]]_end_");
+    Program prog = Program::parse_from_istream(&endless, MemoryModel(), IOModel());
+    ReachOptions deepening;
+    deepening.iterative_deepening = true;
+    bool bounded = true;
+    auto m_run = check_reach(prog, "end", deepening, &bounded);
+    mu_check(m_run.has_value());
+    mu_check(!bounded);
+    mu_check(m_run.value()->prefix.size() + m_run.value()->cycle.size() == 3);
+
+    ReachOptions shallow;
+    shallow.max_depth = 2;
+    mu_check(!check_reach(prog, "end", shallow, &bounded).has_value());
+    mu_check(bounded);
+    shallow.max_depth = 3;
+    mu_check(check_reach(prog, "end", shallow, &bounded).has_value());
+
+    // A bound the search never gets to leaves the answer exact
+    std::istringstream ends("+[-]_end_");
+    prog = Program::parse_from_istream(&ends, MemoryModel(), IOModel());
+    ReachOptions deep;
+    deep.max_depth = 100;
+    deep.static_analysis = false;
+    mu_check(!check_reach(prog, "end", deep, &bounded).has_value());
+    mu_check(!bounded);
+}
+
+MU_TEST(check_reach_external)
+{
+    // A tiny budget sorts successors in many batches
+    ReachOptions external;
+    external.checker = ReachChecker::ExternalMemory;
+    external.memory_budget = 1 << 12;
+    external.threads = 2;
+    external.static_analysis = false;
+    for (std::string source : {",[_end_]", "_end_+[]", ",>,[-]<[-]_end_", "+[>+<-]_end_", ",[,.]_end_"})
+    {
+        std::istringstream in(source);
+        Program prog = Program::parse_from_istream(&in, MemoryModel(), IOModel());
+        auto m_run = check_reach(prog, "end", external);
+        mu_check(m_run.has_value() == check_reach(prog, "end").has_value());
+        if (m_run.has_value())
+            mu_check(concretize_input(prog, expand_run(m_run.value())).has_value());
+    }
+
+    std::istringstream endless(",[-[>+],[,]]_end_");
+    Program prog = Program::parse_from_istream(&endless, MemoryModel(), IOModel());
+    bool bounded = true;
+    external.max_depth = 3;
+    mu_check(check_reach(prog, "end", external, &bounded).has_value());
+    mu_check(!bounded);
+    external.max_depth = 2;
+    mu_check(!check_reach(prog, "end", external, &bounded).has_value());
+    mu_check(bounded);
+
+    // Every input leads into the same long cycle within a few steps, so it
+    // is all there at a small depth while the run around it isn't
+    std::istringstream long_cycle(",+[[+]+]>+[+]_end_");
+    prog = Program::parse_from_istream(&long_cycle, MemoryModel(), IOModel(1));
+    ReachOptions breadth_first;
+    breadth_first.static_analysis = false;
+    for (unsigned int depth : {2, 5, 8})
+    {
+        external.max_depth = depth;
+        breadth_first.max_depth = depth;
+        bool bfs_bounded = false;
+        mu_check(!check_reach(prog, "end", breadth_first, &bfs_bounded).has_value());
+        mu_check(bfs_bounded);
+        mu_check(!check_reach(prog, "end", external, &bounded).has_value());
+        mu_check(bounded);
+    }
+}
+
+MU_TEST(check_reach_approx)
+{
+    for (ReachApprox approx : {ReachApprox::BitstateHashing, ReachApprox::HashCompaction})
+    {
+        ReachOptions options;
+        options.approx = approx;
+        options.memory_budget = 1 << 20;
+        for (std::string source : {",[_end_]", "_end_+[]", ",>,[-]<[-]_end_", "+[>+<-]_end_", ",[,.]_end_"})
+        {
+            std::istringstream in(source);
+            Program prog = Program::parse_from_istream(&in, MemoryModel(), IOModel());
+            ApproxReport report;
+            auto m_run = check_reach(prog, "end", options, nullptr, &report);
+            mu_check(m_run.has_value() == check_reach(prog, "end").has_value());
+            mu_check(report.states > 0 || source[0] == '_');
+            if (m_run.has_value())
+                mu_check(concretize_input(prog, expand_run(m_run.value())).has_value());
+        }
+    }
+
+    // The only run goes around the whole tape, so the stack gets that deep
+    // unless max_depth stops it first
+    std::istringstream long_cycle("+[[->+<]>]_a_");
+    Program prog = Program::parse_from_istream(&long_cycle, MemoryModel(), IOModel());
+    ReachOptions options;
+    options.approx = ReachApprox::BitstateHashing;
+    options.memory_budget = 1 << 20;
+    bool bounded = true;
+    ApproxReport report;
+    mu_check(check_reach(prog, "a", options, &bounded, &report).has_value());
+    mu_check(!bounded && !report.depth_limited && report.depth == 30001);
+    options.max_depth = 100;
+    mu_check(!check_reach(prog, "a", options, &bounded, &report).has_value());
+    mu_check(bounded && report.depth_limited && report.depth == 100);
+}
+
+MU_TEST(check_reach_all_labels)
+{
+    ReachOptions spot;
+    spot.checker = ReachChecker::SpotEmptiness;
+    ReachOptions abstract;
+    abstract.abstract_input = true;
+    ReachOptions shallow;
+    shallow.max_depth = 2;
+    std::vector<std::string> labels = {"a", "b", "c"};
+    for (std::string source : {",[_a_],[_b_]_c_", "_a_+[-_b_]_c_", ",[>+_b_<-]_a_>[_c_]"})
+    {
+        std::istringstream in(source);
+        Program prog = Program::parse_from_istream(&in, MemoryModel(), IOModel());
+        // The second round with Spot takes the automata from the cache
+        for (ReachOptions options : {ReachOptions(), spot, spot, abstract, shallow})
+        {
+            auto verdicts = check_reach_all(prog, labels, options);
+            mu_check(verdicts.size() == labels.size());
+            for (size_t i = 0; i < labels.size(); i++)
+            {
+                bool bounded = false;
+                auto m_run = check_reach(prog, labels[i], options, &bounded);
+                mu_check(verdicts[i].label == labels[i]);
+                mu_check(verdicts[i].run.has_value() == m_run.has_value());
+                mu_check(verdicts[i].bounded == bounded);
+                if (verdicts[i].run.has_value())
+                    mu_check(concretize_input(prog, expand_run(verdicts[i].run.value())).has_value());
+            }
+        }
+    }
+
+    // The runs around the label are deeper than the levels it took to
+    // explore every state, so the verdicts stay bounded like bfs_reach's,
+    // and runs past max_depth don't count even once every state was found
+    std::istringstream around(",>+<[_a_[-]>-<]>[->++++[-]<]<>++++++[-]<+[]");
+    Program prog = Program::parse_from_istream(&around, MemoryModel(), IOModel(1));
+    for (unsigned int depth = 3; depth <= 12; depth++)
+    {
+        ReachOptions options;
+        options.max_depth = depth;
+        bool bounded = false;
+        auto m_run = bfs_reach(prog, "a", false, options, &bounded);
+        bool space_bounded = false;
+        auto m_space_run = space_reach(prog, bfs_explore(prog, false, options), "a", &space_bounded);
+        mu_check(m_space_run.has_value() == m_run.has_value());
+        mu_check(space_bounded == bounded);
+        auto verdicts = check_reach_all(prog, {"a"}, options);
+        mu_check(verdicts.front().run.has_value() == m_run.has_value());
+        mu_check(verdicts.front().bounded == bounded);
+    }
+}
+
+// Paths of the files in a directory
+static std::vector<std::string> directory_files(const char *directory)
+{
+    std::vector<std::string> paths;
+    DIR *dir = opendir(directory);
+    if (dir == nullptr)
+        return paths;
+    for (struct dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir))
+    {
+        if (entry->d_name[0] != '.')
+            paths.push_back(std::string(directory) + "/" + entry->d_name);
+    }
+    closedir(dir);
+    return paths;
+}
+
+MU_TEST(result_cache)
+{
+    char directory[] = "/tmp/braincheck-cacheXXXXXX";
+    mu_check(mkdtemp(directory) != nullptr);
+    std::istringstream in(",[_end_]_a_");
+    Program prog = Program::parse_from_istream(&in, MemoryModel(), IOModel());
+    ReachOptions options;
+    options.cache_directory = directory;
+    ResultCache cache(directory);
+    mu_check(!cache.find_verdict(prog, "end", options).has_value());
+
+    auto m_run = bfs_reach(prog, "end", false, options);
+    mu_check(m_run.has_value());
+    cache.store_verdict(prog, "end", options, CachedVerdict{m_run, false, false});
+    auto m_verdict = cache.find_verdict(prog, "end", options);
+    mu_check(m_verdict.has_value() && m_verdict.value().run.has_value());
+    mu_check(m_verdict.value().run.value().prefix == m_run.value().prefix);
+    mu_check(m_verdict.value().run.value().cycle == m_run.value().cycle);
+
+    // Another label, abstraction or IOModel is another entry
+    ReachOptions abstract = options;
+    abstract.abstract_input = true;
+    std::istringstream again(",[_end_]_a_");
+    Program limited = Program::parse_from_istream(&again, MemoryModel(), IOModel(1));
+    mu_check(!cache.find_verdict(prog, "a", options).has_value());
+    mu_check(!cache.find_verdict(prog, "end", abstract).has_value());
+    mu_check(!cache.find_verdict(limited, "end", options).has_value());
+
+    // A state space decides every label like bfs_reach does
+    cache.store_space(prog, options, bfs_explore(prog, false, options));
+    auto m_space = cache.find_space(prog, false, options);
+    mu_check(m_space.has_value());
+    for (std::string label : {"end", "a"})
+    {
+        auto m_space_run = space_reach(prog, m_space.value(), label);
+        auto m_label_run = bfs_reach(prog, label, false, options);
+        mu_check(m_space_run.has_value() == m_label_run.has_value());
+        if (m_space_run.has_value())
+            mu_check(m_space_run.value().cycle == m_label_run.value().cycle);
+    }
+
+    // Check a cached verdict against a fresh one, then damage every file
+    mu_check(check_reach(prog, "a", options).has_value() == check_reach(prog, "a").has_value());
+    mu_check(check_reach(prog, "a", options).has_value() == check_reach(prog, "a").has_value());
+    std::vector<std::string> paths = directory_files(directory);
+    mu_check(paths.size() == 3);
+    for (const std::string &path : paths)
+        mu_check(truncate(path.c_str(), 20) == 0);
+    mu_check(!cache.find_verdict(prog, "end", options).has_value());
+    mu_check(!cache.find_space(prog, false, options).has_value());
+    for (const std::string &path : paths)
+        unlink(path.c_str());
+    rmdir(directory);
+}
+
+MU_TEST(result_cache_bounded)
+{
+    // Runs around the label are deeper than the levels of the space
+    char directory[] = "/tmp/braincheck-cacheXXXXXX";
+    mu_check(mkdtemp(directory) != nullptr);
+    std::istringstream in(",>+<[_a_[-]>-<]>[->++++[-]<]<>++++++[-]<+[]");
+    Program prog = Program::parse_from_istream(&in, MemoryModel(), IOModel(1));
+    for (unsigned int depth = 3; depth <= 12; depth++)
+    {
+        ReachOptions fresh;
+        fresh.max_depth = depth;
+        fresh.static_analysis = false;
+        ReachOptions cached = fresh;
+        cached.cache_directory = directory;
+        ResultCache(directory).store_space(prog, cached, bfs_explore(prog, false, cached));
+        bool fresh_bounded = false;
+        bool fresh_run = check_reach(prog, "a", fresh, &fresh_bounded).has_value();
+        // First from the space, then from the verdict kept on the way
+        for (int round = 0; round < 2; round++)
+        {
+            bool bounded = !fresh_bounded;
+            mu_check(check_reach(prog, "a", cached, &bounded).has_value() == fresh_run);
+            mu_check(bounded == fresh_bounded);
+        }
+    }
+    for (const std::string &path : directory_files(directory))
+        unlink(path.c_str());
+    rmdir(directory);
+}
+
+MU_TEST(static_analysis)
+{
+    // Verdicts of the programs for the label "a"
+    std::vector<std::pair<std::string, StaticVerdict>> cases = {
+        {"+[-]_a_", StaticAlwaysReached},   // before the first choice
+        {",_a_", StaticAlwaysReached},      // on every path
+        {",[-]_a_", StaticUnknown},         // the loop may never end
+        {"[_a_]", StaticRunFound},          // the only run skips the loop
+        {",>[_a_]", StaticRunFound},        // the loop tests a cell still zero
+        {",[_a_]", StaticUnknown}};         // the read decides
+    ReachOptions searched;
+    searched.static_analysis = false;
+    for (const auto &kv : cases)
+    {
+        std::istringstream in(kv.first);
+        Program prog = Program::parse_from_istream(&in, MemoryModel(), IOModel());
+        FlowAnalysis flow(prog);
+        ReachRun run;
+        mu_check(flow.decide(prog, "a", &run) == kv.second);
+        if (kv.second == StaticRunFound)
+            mu_check(!run.prefix.empty() || !run.cycle.empty());
+        mu_check(check_reach(prog, "a").has_value() == check_reach(prog, "a", searched).has_value());
+    }
+
+    std::istringstream dead(",>[_a_]");
+    Program prog = Program::parse_from_istream(&dead, MemoryModel(), IOModel());
+    FlowAnalysis flow(prog);
+    for (const auto &kv : prog.get_label_map())
+        mu_check(!flow.is_reachable(kv.first));
+    mu_check(flow.is_reachable(0));
+}
+
 MU_TEST_SUITE(analysis)
 {
+    MU_RUN_TEST(kripke_successors);
+    MU_RUN_TEST(input_classes);
+    MU_RUN_TEST(kripke_chains);
     MU_RUN_TEST(check_reach_ok);
     MU_RUN_TEST(check_reach_nonreachable);
     MU_RUN_TEST(check_reach_limited_input);
+    MU_RUN_TEST(check_reach_abstract_input);
+    MU_RUN_TEST(check_reach_ended_runs);
+    MU_RUN_TEST(check_reach_threads);
+    MU_RUN_TEST(check_reach_breadth_first);
+    MU_RUN_TEST(check_reach_wide_tape);
+    MU_RUN_TEST(check_reach_max_depth);
+    MU_RUN_TEST(check_reach_external);
+    MU_RUN_TEST(check_reach_approx);
+    MU_RUN_TEST(check_reach_all_labels);
+    MU_RUN_TEST(result_cache);
+    MU_RUN_TEST(result_cache_bounded);
+    MU_RUN_TEST(static_analysis);
 }
 
 int main()
 {
     MU_RUN_SUITE(parsing);
     MU_RUN_SUITE(models);
+    MU_RUN_SUITE(bytecode);
     MU_RUN_SUITE(hashing);
+    MU_RUN_SUITE(batch);
     MU_RUN_SUITE(analysis);
     MU_REPORT();
     return MU_EXIT_CODE;